@@ -31,6 +31,7 @@
 #include "pk-backend-alpm.h"
 #include "pk-alpm-config.h"
 #include "pk-alpm-databases.h"
+#include "pk-alpm-download.h"
 #include "pk-alpm-error.h"
 
 // bad API choice
@@ -957,7 +958,7 @@ pk_alpm_config_configure_alpm (PkBackend *backend, PkAlpmConfig *config, GError
 	if (xfercmd != NULL) {
 		alpm_option_set_fetchcb (handle, pk_alpm_fetchcb);
 	} else {
-		alpm_option_set_fetchcb (handle, NULL);
+		pk_alpm_download_initialize (handle);
 	}
 
 	/* backend takes ownership */
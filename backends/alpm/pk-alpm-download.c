@@ -0,0 +1,502 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The PackageKit Authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <curl/curl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <syslog.h>
+#include <utime.h>
+#include <glib/gstdio.h>
+
+#include "pk-backend-alpm.h"
+#include "pk-alpm-download.h"
+
+#define PK_ALPM_DOWNLOAD_MAX_PARALLEL	4
+
+typedef struct {
+	PkBackendJob		*job;
+	CURL			*curl;
+	FILE			*fp;
+	const alpm_list_t	*servers;
+	gchar			*basename;
+	gchar			*file;
+	gchar			*part;
+	off_t			 size;
+	curl_off_t		 offset;
+	curl_off_t		 now;
+	curl_off_t		 total;
+	gboolean		 started;
+} PkAlpmDownload;
+
+static alpm_handle_t *download_handle = NULL;
+static CURLSH *download_share = NULL;
+static CURL *download_curl = NULL;
+
+static int
+pk_alpm_download_progress_cb (void *data, curl_off_t dltotal, curl_off_t dlnow,
+			      curl_off_t ultotal, curl_off_t ulnow)
+{
+	PkAlpmDownload *dl = (PkAlpmDownload *) data;
+	alpm_cb_download dlcb;
+	curl_off_t now, total;
+
+	/* parallel downloads are reported per file by the caller */
+	if (dl->job != NULL)
+		return pk_backend_job_is_cancelled (dl->job) ? 1 : 0;
+
+	dlcb = alpm_option_get_dlcb (download_handle);
+	if (dlcb == NULL || dltotal <= 0)
+		return 0;
+
+	now = dl->offset + dlnow;
+	total = dl->offset + dltotal;
+
+	/* like libalpm, only start reporting once the size is known */
+	if (!dl->started) {
+		dlcb (dl->basename, 0, total);
+		dl->started = TRUE;
+	} else if (now != dl->now && now < total) {
+		dlcb (dl->basename, now, total);
+	}
+
+	dl->now = now;
+	dl->total = total;
+	return 0;
+}
+
+static void
+pk_alpm_download_setup (CURL *curl)
+{
+	curl_easy_setopt (curl, CURLOPT_SHARE, download_share);
+	curl_easy_setopt (curl, CURLOPT_USERAGENT, "PackageKit-alpm");
+	curl_easy_setopt (curl, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt (curl, CURLOPT_FAILONERROR, 1L);
+	curl_easy_setopt (curl, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt (curl, CURLOPT_FILETIME, 1L);
+	curl_easy_setopt (curl, CURLOPT_CONNECTTIMEOUT, 10L);
+
+	/* give up on stalled mirrors the same way libalpm does */
+	curl_easy_setopt (curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+	curl_easy_setopt (curl, CURLOPT_LOW_SPEED_TIME, 10L);
+
+	curl_easy_setopt (curl, CURLOPT_NOPROGRESS, 0L);
+	curl_easy_setopt (curl, CURLOPT_XFERINFOFUNCTION,
+			  pk_alpm_download_progress_cb);
+}
+
+static gboolean
+pk_alpm_download_open (PkAlpmDownload *dl, gboolean resume)
+{
+	GStatBuf st;
+
+	g_return_val_if_fail (dl != NULL, FALSE);
+
+	dl->offset = 0;
+	if (resume && g_stat (dl->part, &st) == 0)
+		dl->offset = st.st_size;
+
+	dl->fp = fopen (dl->part, dl->offset > 0 ? "ab" : "wb");
+	if (dl->fp == NULL) {
+		syslog (LOG_DAEMON | LOG_WARNING, "could not open %s: %s",
+			dl->part, g_strerror (errno));
+		return FALSE;
+	}
+
+	curl_easy_setopt (dl->curl, CURLOPT_WRITEDATA, dl->fp);
+	curl_easy_setopt (dl->curl, CURLOPT_RESUME_FROM_LARGE, dl->offset);
+	curl_easy_setopt (dl->curl, CURLOPT_XFERINFODATA, dl);
+
+	dl->now = 0;
+	dl->total = 0;
+	dl->started = FALSE;
+	return TRUE;
+}
+
+static gboolean
+pk_alpm_download_restart (PkAlpmDownload *dl, CURLcode res)
+{
+	glong code = 0;
+
+	if (dl->offset == 0)
+		return FALSE;
+	if (res == CURLE_RANGE_ERROR)
+		return TRUE;
+
+	/* the partial file is already complete or bigger than the new one */
+	curl_easy_getinfo (dl->curl, CURLINFO_RESPONSE_CODE, &code);
+	return res == CURLE_HTTP_RETURNED_ERROR && code == 416;
+}
+
+static gboolean
+pk_alpm_download_finish (PkAlpmDownload *dl)
+{
+	glong filetime = -1;
+
+	g_return_val_if_fail (dl != NULL, FALSE);
+
+	fclose (dl->fp);
+	dl->fp = NULL;
+
+	if (g_rename (dl->part, dl->file) < 0) {
+		syslog (LOG_DAEMON | LOG_WARNING, "could not rename %s", dl->part);
+		return FALSE;
+	}
+
+	/* keep the server time so databases can be checked with If-Modified-Since */
+	curl_easy_getinfo (dl->curl, CURLINFO_FILETIME, &filetime);
+	if (filetime > 0) {
+		struct utimbuf times;
+		times.actime = filetime;
+		times.modtime = filetime;
+		g_utime (dl->file, &times);
+	}
+
+	return TRUE;
+}
+
+gint
+pk_alpm_download_fetchcb (const gchar *url, const gchar *path, gint force)
+{
+	PkAlpmDownload dl = { 0 };
+	CURLcode res;
+	GStatBuf st;
+	glong unmet = 0;
+	gint result = -1;
+
+	g_return_val_if_fail (url != NULL, -1);
+	g_return_val_if_fail (path != NULL, -1);
+	g_return_val_if_fail (download_share != NULL, -1);
+
+	/* reuse one handle so consecutive files share the connection */
+	if (download_curl == NULL)
+		download_curl = curl_easy_init ();
+	else
+		curl_easy_reset (download_curl);
+	if (download_curl == NULL)
+		return -1;
+
+	pk_alpm_download_setup (download_curl);
+	curl_easy_setopt (download_curl, CURLOPT_URL, url);
+
+	dl.curl = download_curl;
+	dl.basename = g_path_get_basename (url);
+	dl.file = g_build_filename (path, dl.basename, NULL);
+	dl.part = g_strconcat (dl.file, ".part", NULL);
+
+	if (force != 0) {
+		g_unlink (dl.part);
+	} else if (!g_file_test (dl.part, G_FILE_TEST_EXISTS) &&
+		   g_stat (dl.file, &st) == 0) {
+		/* only fetch databases again if they changed on the server */
+		curl_easy_setopt (download_curl, CURLOPT_TIMECONDITION,
+				  (glong) CURL_TIMECOND_IFMODSINCE);
+		curl_easy_setopt (download_curl, CURLOPT_TIMEVALUE,
+				  (glong) st.st_mtime);
+	}
+
+	if (!pk_alpm_download_open (&dl, force == 0))
+		goto out;
+
+	res = curl_easy_perform (download_curl);
+	if (res != CURLE_OK && pk_alpm_download_restart (&dl, res)) {
+		fclose (dl.fp);
+		dl.fp = NULL;
+		if (!pk_alpm_download_open (&dl, FALSE))
+			goto out;
+		res = curl_easy_perform (download_curl);
+	}
+
+	/* leave the partial file behind so the next attempt can resume */
+	if (res != CURLE_OK) {
+		syslog (LOG_DAEMON | LOG_WARNING, "could not download %s: %s",
+			url, curl_easy_strerror (res));
+		goto out;
+	}
+
+	curl_easy_getinfo (download_curl, CURLINFO_CONDITION_UNMET, &unmet);
+	if (unmet != 0) {
+		fclose (dl.fp);
+		dl.fp = NULL;
+		g_unlink (dl.part);
+		result = 1;
+		goto out;
+	}
+
+	if (!pk_alpm_download_finish (&dl))
+		goto out;
+
+	if (dl.started) {
+		alpm_cb_download dlcb = alpm_option_get_dlcb (download_handle);
+		if (dlcb != NULL)
+			dlcb (dl.basename, dl.total, dl.total);
+	}
+	result = 0;
+out:
+	if (dl.fp != NULL)
+		fclose (dl.fp);
+	g_free (dl.basename);
+	g_free (dl.file);
+	g_free (dl.part);
+	return result;
+}
+
+static void
+pk_alpm_download_free (PkAlpmDownload *dl)
+{
+	if (dl->fp != NULL)
+		fclose (dl->fp);
+	if (dl->curl != NULL)
+		curl_easy_cleanup (dl->curl);
+	g_free (dl->basename);
+	g_free (dl->file);
+	g_free (dl->part);
+	g_free (dl);
+}
+
+static PkAlpmDownload *
+pk_alpm_download_new (PkBackendJob *job, alpm_pkg_t *pkg, const gchar *cachedir)
+{
+	PkAlpmDownload *dl;
+
+	dl = g_new0 (PkAlpmDownload, 1);
+	dl->job = job;
+	dl->servers = alpm_db_get_servers (alpm_pkg_get_db (pkg));
+	dl->basename = g_strdup (alpm_pkg_get_filename (pkg));
+	dl->file = g_build_filename (cachedir, dl->basename, NULL);
+	dl->part = g_strconcat (dl->file, ".part", NULL);
+	dl->size = alpm_pkg_get_size (pkg);
+
+	dl->curl = curl_easy_init ();
+	if (dl->curl == NULL) {
+		pk_alpm_download_free (dl);
+		return NULL;
+	}
+	pk_alpm_download_setup (dl->curl);
+	curl_easy_setopt (dl->curl, CURLOPT_PRIVATE, dl);
+	return dl;
+}
+
+static gboolean
+pk_alpm_download_start (CURLM *multi, PkAlpmDownload *dl, gboolean resume)
+{
+	g_autofree gchar *url = NULL;
+
+	if (dl->servers == NULL)
+		return FALSE;
+
+	url = g_strdup_printf ("%s/%s", (const gchar *) dl->servers->data,
+			       dl->basename);
+	curl_easy_setopt (dl->curl, CURLOPT_URL, url);
+
+	if (!pk_alpm_download_open (dl, resume))
+		return FALSE;
+
+	return curl_multi_add_handle (multi, dl->curl) == CURLM_OK;
+}
+
+static gboolean
+pk_alpm_download_is_cached (const alpm_list_t *cachedirs, const gchar *filename)
+{
+	const alpm_list_t *i;
+
+	for (i = cachedirs; i != NULL; i = i->next) {
+		g_autofree gchar *path = NULL;
+		path = g_build_filename (i->data, filename, NULL);
+		if (g_file_test (path, G_FILE_TEST_EXISTS))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * pk_alpm_download_packages:
+ *
+ * Fetches the packages of the current transaction into the cache several at a
+ * time before libalpm commits it. Anything that fails here is left for libalpm
+ * to download again, so errors are reported the usual way.
+ **/
+void
+pk_alpm_download_packages (PkBackendJob *job)
+{
+	PkBackend *backend = pk_backend_job_get_backend (job);
+	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (backend);
+	const alpm_list_t *cachedirs, *i;
+	alpm_cb_download dlcb;
+	alpm_cb_totaldl totaldlcb;
+	GQueue queue = G_QUEUE_INIT;
+	CURLM *multi;
+	off_t total = 0;
+	guint running = 0, j;
+	g_autoptr(GPtrArray) downloads = NULL;
+
+	/* XferCommand is in use */
+	if (alpm_option_get_fetchcb (priv->alpm) != pk_alpm_download_fetchcb)
+		return;
+
+	cachedirs = alpm_option_get_cachedirs (priv->alpm);
+	if (cachedirs == NULL)
+		return;
+
+	downloads = g_ptr_array_new_with_free_func ((GDestroyNotify) pk_alpm_download_free);
+	for (i = alpm_trans_get_add (priv->alpm); i != NULL; i = i->next) {
+		alpm_pkg_t *pkg = (alpm_pkg_t *) i->data;
+		PkAlpmDownload *dl;
+
+		if (alpm_pkg_get_origin (pkg) != ALPM_PKG_FROM_SYNCDB)
+			continue;
+		if (pk_alpm_download_is_cached (cachedirs, alpm_pkg_get_filename (pkg)))
+			continue;
+
+		/* let libalpm choose between deltas and the full package */
+		if (alpm_option_get_deltaratio (priv->alpm) != 0.0 &&
+		    alpm_pkg_get_deltas (pkg) != NULL)
+			continue;
+
+		dl = pk_alpm_download_new (job, pkg, cachedirs->data);
+		if (dl == NULL || dl->servers == NULL) {
+			if (dl != NULL)
+				pk_alpm_download_free (dl);
+			continue;
+		}
+
+		g_ptr_array_add (downloads, dl);
+		g_queue_push_tail (&queue, dl);
+		total += dl->size;
+	}
+
+	if (downloads->len == 0)
+		return;
+
+	dlcb = alpm_option_get_dlcb (priv->alpm);
+	totaldlcb = alpm_option_get_totaldlcb (priv->alpm);
+	if (totaldlcb != NULL)
+		totaldlcb (total);
+	pk_backend_job_set_status (job, PK_STATUS_ENUM_DOWNLOAD);
+
+	multi = curl_multi_init ();
+	while (!pk_backend_job_is_cancelled (job)) {
+		CURLMsg *msg;
+		gint left, still;
+
+		while (running < PK_ALPM_DOWNLOAD_MAX_PARALLEL &&
+		       !g_queue_is_empty (&queue)) {
+			PkAlpmDownload *dl = g_queue_pop_head (&queue);
+			if (pk_alpm_download_start (multi, dl, TRUE))
+				running++;
+		}
+		if (running == 0)
+			break;
+
+		curl_multi_perform (multi, &still);
+		while ((msg = curl_multi_info_read (multi, &left)) != NULL) {
+			PkAlpmDownload *dl = NULL;
+			CURLcode res = msg->data.result;
+			gboolean resume = TRUE;
+
+			if (msg->msg != CURLMSG_DONE)
+				continue;
+
+			curl_easy_getinfo (msg->easy_handle, CURLINFO_PRIVATE, &dl);
+			curl_multi_remove_handle (multi, dl->curl);
+			running--;
+
+			/* the transaction callbacks follow one package at a
+			 * time, so only report files once they are complete */
+			if (res == CURLE_OK && pk_alpm_download_finish (dl)) {
+				if (dlcb != NULL) {
+					dlcb (dl->basename, 0, dl->size);
+					dlcb (dl->basename, dl->size, dl->size);
+				}
+				dl->servers = NULL;
+				continue;
+			}
+
+			if (dl->fp != NULL) {
+				fclose (dl->fp);
+				dl->fp = NULL;
+			}
+			if (pk_backend_job_is_cancelled (job))
+				continue;
+
+			if (pk_alpm_download_restart (dl, res)) {
+				resume = FALSE;
+			} else {
+				syslog (LOG_DAEMON | LOG_WARNING,
+					"could not download %s from %s: %s",
+					dl->basename,
+					(const gchar *) dl->servers->data,
+					curl_easy_strerror (res));
+				dl->servers = dl->servers->next;
+			}
+			if (pk_alpm_download_start (multi, dl, resume))
+				running++;
+		}
+
+		curl_multi_wait (multi, NULL, 0, 500, NULL);
+	}
+
+	for (j = 0; j < downloads->len; j++) {
+		PkAlpmDownload *dl = g_ptr_array_index (downloads, j);
+		curl_multi_remove_handle (multi, dl->curl);
+	}
+	curl_multi_cleanup (multi);
+
+	/* finish off the last package before libalpm takes over */
+	if (totaldlcb != NULL)
+		totaldlcb (0);
+}
+
+void
+pk_alpm_download_initialize (alpm_handle_t *handle)
+{
+	g_return_if_fail (handle != NULL);
+
+	if (download_share == NULL) {
+		curl_global_init (CURL_GLOBAL_ALL);
+		download_share = curl_share_init ();
+		curl_share_setopt (download_share, CURLSHOPT_SHARE,
+				   CURL_LOCK_DATA_CONNECT);
+		curl_share_setopt (download_share, CURLSHOPT_SHARE,
+				   CURL_LOCK_DATA_DNS);
+		curl_share_setopt (download_share, CURLSHOPT_SHARE,
+				   CURL_LOCK_DATA_SSL_SESSION);
+	}
+
+	download_handle = handle;
+	alpm_option_set_fetchcb (handle, pk_alpm_download_fetchcb);
+}
+
+void
+pk_alpm_download_destroy (void)
+{
+	if (download_curl != NULL) {
+		curl_easy_cleanup (download_curl);
+		download_curl = NULL;
+	}
+	if (download_share != NULL) {
+		curl_share_cleanup (download_share);
+		download_share = NULL;
+		curl_global_cleanup ();
+	}
+	download_handle = NULL;
+}
@@ -0,0 +1,103 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The PackageKit Authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "pk-alpm-provides.h"
+
+GHashTable *
+pk_alpm_provides_index_new (alpm_db_t *db)
+{
+	GHashTable *provides;
+	const alpm_list_t *i, *j;
+
+	g_return_val_if_fail (db != NULL, NULL);
+
+	/* map every provide name to the packages providing it */
+	provides = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+					  (GDestroyNotify) g_ptr_array_unref);
+	for (i = alpm_db_get_pkgcache (db); i != NULL; i = i->next) {
+		for (j = alpm_pkg_get_provides (i->data); j != NULL; j = j->next) {
+			alpm_depend_t *provide = j->data;
+			GPtrArray *pkgs = g_hash_table_lookup (provides, provide->name);
+
+			if (pkgs == NULL) {
+				pkgs = g_ptr_array_new ();
+				g_hash_table_insert (provides, provide->name, pkgs);
+			}
+
+			/* a package may provide several versions of a name */
+			if (pkgs->len == 0 || g_ptr_array_index (pkgs, pkgs->len - 1) != i->data)
+				g_ptr_array_add (pkgs, i->data);
+		}
+	}
+
+	return provides;
+}
+
+static gboolean
+pk_alpm_provide_satisfies (alpm_depend_t *provide, alpm_depend_t *depend)
+{
+	gint cmp;
+
+	if (g_strcmp0 (provide->name, depend->name) != 0)
+		return FALSE;
+
+	/* any version will do */
+	if (depend->mod == ALPM_DEP_MOD_ANY)
+		return TRUE;
+
+	/* an unversioned provide does not satisfy a versioned search */
+	if (provide->mod != ALPM_DEP_MOD_EQ || provide->version == NULL)
+		return FALSE;
+
+	cmp = alpm_pkg_vercmp (provide->version, depend->version);
+	switch (depend->mod) {
+	case ALPM_DEP_MOD_EQ:
+		return cmp == 0;
+	case ALPM_DEP_MOD_GE:
+		return cmp >= 0;
+	case ALPM_DEP_MOD_LE:
+		return cmp <= 0;
+	case ALPM_DEP_MOD_GT:
+		return cmp > 0;
+	case ALPM_DEP_MOD_LT:
+		return cmp < 0;
+	default:
+		return FALSE;
+	}
+}
+
+gboolean
+pk_alpm_pkg_match_provides (alpm_pkg_t *pkg, alpm_depend_t *depend)
+{
+	/* TODO: implement GStreamer codecs, Pango fonts, etc. */
+	const alpm_list_t *i;
+
+	g_return_val_if_fail (pkg != NULL, FALSE);
+	g_return_val_if_fail (depend != NULL, FALSE);
+
+	/* match features provided by package */
+	for (i = alpm_pkg_get_provides (pkg); i != NULL; i = i->next) {
+		if (pk_alpm_provide_satisfies (i->data, depend))
+			return TRUE;
+	}
+
+	return FALSE;
+}
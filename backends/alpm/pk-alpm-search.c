@@ -26,8 +26,10 @@
 #include <string.h>
 
 #include "pk-backend-alpm.h"
+#include "pk-alpm-error.h"
 #include "pk-alpm-groups.h"
 #include "pk-alpm-packages.h"
+#include "pk-alpm-provides.h"
 
 static gpointer
 pk_backend_pattern_needle (PkBackend *backend, const gchar *needle, GError **error)
@@ -67,6 +69,21 @@ pk_backend_pattern_chroot (PkBackend *backend, const gchar *needle, GError **err
 	return (gpointer) needle;
 }
 
+static gpointer
+pk_backend_pattern_provides (PkBackend *backend, const gchar *needle, GError **error)
+{
+	alpm_depend_t *depend;
+	g_return_val_if_fail (needle != NULL, NULL);
+
+	/* split "name=version" and friends like a dependency */
+	depend = alpm_dep_from_string (needle);
+	if (depend == NULL) {
+		g_set_error (error, PK_ALPM_ERROR, ALPM_ERR_WRONG_ARGS,
+			     "invalid provide: %s", needle);
+	}
+	return depend;
+}
+
 static gboolean
 pk_backend_match_all (alpm_pkg_t *pkg, gpointer pattern)
 {
@@ -170,29 +187,45 @@ pk_backend_match_name (alpm_pkg_t *pkg, GRegex *regex)
 	return g_regex_match (regex, alpm_pkg_get_name (pkg), 0, NULL);
 }
 
-static gboolean
-pk_alpm_pkg_match_provides (alpm_pkg_t *pkg, gpointer pattern)
+static GPtrArray *
+pk_alpm_search_get_providers (PkBackend *backend, alpm_db_t *db, const gchar *name)
 {
-	/* TODO: implement GStreamer codecs, Pango fonts, etc. */
-	const alpm_list_t *i;
-
-	g_return_val_if_fail (pkg != NULL, FALSE);
-	g_return_val_if_fail (pattern != NULL, FALSE);
+	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (backend);
+	GHashTable *provides;
 
-	/* match features provided by package */
-	for (i = alpm_pkg_get_provides (pkg); i != NULL; i = i->next) {
-		const gchar *needle = pattern, *name = i->data;
+	if (priv->provides == NULL) {
+		priv->provides = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+							(GDestroyNotify) g_hash_table_unref);
+	}
 
-		for (; *needle == *name; ++needle, ++name) {
-			if (*needle == '\0') {
-				if (*name == '\0' || *name == '=')
-					return TRUE;
-				break;
-			}
-		}
+	/* index every provide of the db the first time it is searched */
+	provides = g_hash_table_lookup (priv->provides, db);
+	if (provides == NULL) {
+		provides = pk_alpm_provides_index_new (db);
+		g_hash_table_insert (priv->provides, db, provides);
 	}
 
-	return FALSE;
+	return g_hash_table_lookup (provides, name);
+}
+
+void
+pk_alpm_search_invalidate_provides (PkBackend *backend, alpm_db_t *db)
+{
+	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (backend);
+
+	/* the packages in the index belong to the old pkgcache */
+	if (priv->provides != NULL)
+		g_hash_table_remove (priv->provides, db);
+}
+
+void
+pk_alpm_search_clear_provides (PkBackend *backend)
+{
+	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (backend);
+
+	/* the index is keyed by db, which is gone once it is unregistered */
+	if (priv->provides != NULL)
+		g_hash_table_remove_all (priv->provides);
 }
 
 typedef enum {
@@ -214,7 +247,7 @@ static PatternFunc pattern_funcs[] = {
 	pk_backend_pattern_chroot,
 	pk_backend_pattern_needle,
 	pk_backend_pattern_regex,
-	pk_backend_pattern_needle
+	pk_backend_pattern_provides
 };
 
 static GDestroyNotify pattern_frees[] = {
@@ -223,7 +256,7 @@ static GDestroyNotify pattern_frees[] = {
 	NULL,
 	NULL,
 	(GDestroyNotify) g_regex_unref,
-	NULL
+	(GDestroyNotify) alpm_dep_free
 };
 
 static MatchFunc match_funcs[] = {
@@ -232,7 +265,7 @@ static MatchFunc match_funcs[] = {
 	(MatchFunc) pk_backend_match_file,
 	(MatchFunc) pk_backend_match_group,
 	(MatchFunc) pk_backend_match_name,
-	pk_alpm_pkg_match_provides
+	(MatchFunc) pk_alpm_pkg_match_provides
 };
 
 static gboolean
@@ -282,44 +315,70 @@ pk_alpm_search_is_application (alpm_pkg_t *pkg) {
 	return FALSE;
 }
 
+static void
+pk_backend_search_pkg (PkBackendJob *job, alpm_db_t *db, alpm_pkg_t *pkg,
+		       MatchFunc match, const alpm_list_t *patterns,
+		       PkBitfield filters)
+{
+	PkBackend *backend = pk_backend_job_get_backend (job);
+	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (backend);
+	const alpm_list_t *i;
+
+	for (i = patterns; i != NULL; i = i->next) {
+		if (!match (pkg, i->data))
+			break;
+	}
+
+	/* not all search terms matched */
+	if (i != NULL)
+		return;
+
+	/* want applications */
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_APPLICATION) && !pk_alpm_search_is_application (pkg))
+		return;
+
+	/* don't want applications */
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_APPLICATION) && pk_alpm_search_is_application (pkg))
+		return;
+
+	if (db == priv->localdb) {
+		pk_alpm_pkg_emit (job, pkg, PK_INFO_ENUM_INSTALLED);
+	} else if (!pk_alpm_pkg_is_local (job, pkg)) {
+		pk_alpm_pkg_emit (job, pkg, PK_INFO_ENUM_AVAILABLE);
+	}
+}
+
 static void
 pk_backend_search_db (PkBackendJob *job, alpm_db_t *db, MatchFunc match,
 		      const alpm_list_t *patterns, PkBitfield filters)
 {
 	PkBackend *backend = pk_backend_job_get_backend (job);
-	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (backend);
-	const alpm_list_t *i, *j;
+	const alpm_list_t *i;
+	GPtrArray *pkgs;
+	guint j;
 
 	g_return_if_fail (db != NULL);
 	g_return_if_fail (match != NULL);
 
+	/* only packages providing the name of the first term can match
+	 * them all, the versions are checked by the matcher */
+	if (match == (MatchFunc) pk_alpm_pkg_match_provides && patterns != NULL) {
+		alpm_depend_t *depend = patterns->data;
+		pkgs = pk_alpm_search_get_providers (backend, db, depend->name);
+		for (j = 0; pkgs != NULL && j < pkgs->len; j++) {
+			if (pk_backend_job_is_cancelled (job))
+				break;
+			pk_backend_search_pkg (job, db, g_ptr_array_index (pkgs, j),
+					       match, patterns, filters);
+		}
+		return;
+	}
+
 	/* emit packages that match all search terms */
 	for (i = alpm_db_get_pkgcache (db); i != NULL; i = i->next) {
 		if (pk_backend_job_is_cancelled (job))
 			break;
-
-		for (j = patterns; j != NULL; j = j->next) {
-			if (!match (i->data, j->data))
-				break;
-		}
-
-		/* not all search terms matched */
-		if (j != NULL)
-			continue;
-
-		/* want applications */
-		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_APPLICATION) && !pk_alpm_search_is_application (i->data))
-			continue;
-
-		/* don't want applications */
-		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_APPLICATION) && pk_alpm_search_is_application (i->data))
-			continue;
-
-		if (db == priv->localdb) {
-			pk_alpm_pkg_emit (job, i->data, PK_INFO_ENUM_INSTALLED);
-		} else if (!pk_alpm_pkg_is_local (job, i->data)) {
-			pk_alpm_pkg_emit (job, i->data, PK_INFO_ENUM_AVAILABLE);
-		}
+		pk_backend_search_pkg (job, db, i->data, match, patterns, filters);
 	}
 }
 
@@ -22,6 +22,7 @@
  */
 
 #include "pk-backend-alpm.h"
+#include "pk-alpm-download.h"
 #include "pk-alpm-error.h"
 #include "pk-alpm-packages.h"
 #include "pk-alpm-transaction.h"
@@ -1053,6 +1054,11 @@ pk_alpm_transaction_commit (PkBackendJob *job, GError **error)
 	g_autofree gchar *prefix = NULL;
 	gint commit_result;
 
+	if (pk_backend_job_is_cancelled (job))
+		return TRUE;
+
+	/* fetch packages in parallel while we can still be cancelled */
+	pk_alpm_download_packages (job);
 	if (pk_backend_job_is_cancelled (job))
 		return TRUE;
 
@@ -1062,6 +1068,7 @@ pk_alpm_transaction_commit (PkBackendJob *job, GError **error)
 	pk_backend_transaction_inhibit_start (backend);
 	commit_result = alpm_trans_commit (priv->alpm, &data);
 	pk_backend_transaction_inhibit_end (backend);
+	pk_alpm_search_invalidate_provides (backend, priv->localdb);
 	if (commit_result >= 0)
 		return TRUE;
 
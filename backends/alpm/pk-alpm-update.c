@@ -273,6 +273,7 @@ pk_alpm_update_database (PkBackendJob *job, gint force, alpm_db_t *db, GError **
 
 	result = alpm_db_update (force, db);
 	if (result > 0) {
+		pk_alpm_search_invalidate_provides (backend, db);
 		dlcb ("", 1, 1);
 	} else if (result < 0) {
 		g_set_error (error, PK_ALPM_ERROR, alpm_errno (priv->alpm), "[%s]: %s",
@@ -31,6 +31,7 @@
 #include "pk-backend-alpm.h"
 #include "pk-alpm-config.h"
 #include "pk-alpm-databases.h"
+#include "pk-alpm-download.h"
 #include "pk-alpm-error.h"
 #include "pk-alpm-groups.h"
 #include "pk-alpm-transaction.h"
@@ -173,9 +174,12 @@ pk_backend_destroy (PkBackend *backend)
 			alpm_trans_release (priv->alpm);
 		alpm_release (priv->alpm);
 	}
+	pk_alpm_download_destroy ();
 
 	FREELIST (priv->syncfirsts);
 	FREELIST (priv->holdpkgs);
+	if (priv->provides != NULL)
+		g_hash_table_unref (priv->provides);
 	g_free (priv);
 }
 
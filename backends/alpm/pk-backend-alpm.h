@@ -33,9 +33,14 @@ typedef struct {
 	GFileMonitor    *monitor;
 	alpm_list_t     *configured_repos; /* list of configured repos */
 	gboolean	localdb_changed;
+	GHashTable	*provides; /* db to provide name to packages */
 } PkBackendAlpmPrivate;
 
 void		 pk_alpm_run		(PkBackendJob *job, PkStatusEnum status,
 					 PkBackendJobThreadFunc func, gpointer data);
 
 gboolean	 pk_alpm_finish		(PkBackendJob *job, GError *error);
+
+void		 pk_alpm_search_invalidate_provides (PkBackend *backend,
+						     alpm_db_t *db);
+void		 pk_alpm_search_clear_provides (PkBackend *backend);
@@ -0,0 +1,147 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The PackageKit Authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <glib/gstdio.h>
+
+#include "pk-alpm-provides.h"
+
+static void
+pk_alpm_test_add_pkg (const gchar *name, const gchar *version, const gchar *provides)
+{
+	g_autofree gchar *dir = NULL;
+	g_autofree gchar *desc = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GError) error = NULL;
+
+	dir = g_strdup_printf (TEST_DBPATH "/local/%s-%s", name, version);
+	g_assert_cmpint (g_mkdir_with_parents (dir, 0755), ==, 0);
+	desc = g_strdup_printf ("%%NAME%%\n%s\n\n"
+				"%%VERSION%%\n%s\n\n"
+				"%%PROVIDES%%\n%s\n\n",
+				name, version, provides);
+	filename = g_build_filename (dir, "desc", NULL);
+	g_file_set_contents (filename, desc, -1, &error);
+	g_assert_no_error (error);
+}
+
+/* look the term up the way a WhatProvides search does */
+static GPtrArray *
+pk_alpm_test_search_index (GHashTable *index, const gchar *needle)
+{
+	GPtrArray *found = g_ptr_array_new ();
+	GPtrArray *pkgs;
+	alpm_depend_t *depend = alpm_dep_from_string (needle);
+	guint i;
+
+	pkgs = g_hash_table_lookup (index, depend->name);
+	for (i = 0; pkgs != NULL && i < pkgs->len; i++) {
+		if (pk_alpm_pkg_match_provides (g_ptr_array_index (pkgs, i), depend))
+			g_ptr_array_add (found, g_ptr_array_index (pkgs, i));
+	}
+	alpm_dep_free (depend);
+	return found;
+}
+
+/* check every package of the db instead */
+static GPtrArray *
+pk_alpm_test_search_linear (alpm_db_t *db, const gchar *needle)
+{
+	GPtrArray *found = g_ptr_array_new ();
+	alpm_depend_t *depend = alpm_dep_from_string (needle);
+	const alpm_list_t *i;
+
+	for (i = alpm_db_get_pkgcache (db); i != NULL; i = i->next) {
+		if (pk_alpm_pkg_match_provides (i->data, depend))
+			g_ptr_array_add (found, i->data);
+	}
+	alpm_dep_free (depend);
+	return found;
+}
+
+static void
+pk_alpm_test_provides_func (void)
+{
+	alpm_errno_t err = 0;
+	alpm_handle_t *handle;
+	alpm_db_t *db;
+	guint i, j;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GHashTable) index = NULL;
+	struct {
+		const gchar	*needle;
+		guint		 count;
+	} cases[] = {
+		{ "foo",	3 },
+		{ "foo=1.2",	1 },
+		{ "foo=1.3",	1 },
+		{ "foo>=1.2",	2 },
+		{ "foo<1.3",	1 },
+		{ "foo=2",	0 },
+		{ "bar",	1 },
+		{ "bar=2.0",	1 },
+		{ "qux",	0 },
+		{ NULL,		0 }
+	};
+
+	/* a local db with versioned and unversioned provides */
+	g_assert_cmpint (g_mkdir_with_parents (TEST_ROOT, 0755), ==, 0);
+	g_assert_cmpint (g_mkdir_with_parents (TEST_DBPATH "/local", 0755), ==, 0);
+	g_file_set_contents (TEST_DBPATH "/local/ALPM_DB_VERSION", "9\n", -1, &error);
+	g_assert_no_error (error);
+	pk_alpm_test_add_pkg ("alpha", "1.0-1", "foo=1.2");
+	pk_alpm_test_add_pkg ("beta", "1.0-1", "foo");
+	pk_alpm_test_add_pkg ("gamma", "1.0-1", "foo=1.3\nbar=2.0");
+	pk_alpm_test_add_pkg ("delta", "1.0-1", "baz");
+
+	handle = alpm_initialize (TEST_ROOT, TEST_DBPATH, &err);
+	g_assert (handle != NULL);
+	db = alpm_get_localdb (handle);
+	index = pk_alpm_provides_index_new (db);
+
+	/* the index finds the same packages as checking them all */
+	for (i = 0; cases[i].needle != NULL; i++) {
+		g_autoptr(GPtrArray) indexed = NULL;
+		g_autoptr(GPtrArray) linear = NULL;
+
+		indexed = pk_alpm_test_search_index (index, cases[i].needle);
+		linear = pk_alpm_test_search_linear (db, cases[i].needle);
+		g_debug ("%s: %u packages", cases[i].needle, linear->len);
+		g_assert_cmpint (linear->len, ==, cases[i].count);
+		g_assert_cmpint (indexed->len, ==, linear->len);
+		for (j = 0; j < linear->len; j++) {
+			g_assert (g_ptr_array_index (indexed, j) ==
+				  g_ptr_array_index (linear, j));
+		}
+	}
+
+	g_clear_pointer (&index, g_hash_table_unref);
+	alpm_release (handle);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/alpm/provides", pk_alpm_test_provides_func);
+
+	return g_test_run ();
+}
@@ -23,7 +23,11 @@
 
 #include <sstream>
 #include <cstdio>
+#include <list>
+#include <unordered_map>
+#include <sys/stat.h>
 #include <apt-pkg/algorithms.h>
+#include <apt-pkg/configuration.h>
 #include <apt-pkg/progress.h>
 #include <apt-pkg/upgrade.h>
 
@@ -32,9 +36,26 @@
 
 using namespace APT;
 
+// Parsed descriptions keyed by their DescFile, shared by all jobs that see
+// the same cache; the backend does not run jobs in parallel
+#define DESCRIPTION_CACHE_SIZE 4096
+
+typedef struct {
+    unsigned long descFile;
+    std::string shortDesc;
+    std::string longDesc;
+} DescriptionRecord;
+
+static std::list<DescriptionRecord> descriptionLru;
+static std::unordered_map<unsigned long, std::list<DescriptionRecord>::iterator> descriptionIndex;
+static std::string descriptionGeneration;
+
 AptCacheFile::AptCacheFile(PkBackendJob *job) :
     m_packageRecords(0),
-    m_job(job)
+    m_job(job),
+    m_descriptionsChecked(false),
+    m_descriptionHits(0),
+    m_descriptionMisses(0)
 {
 }
 
@@ -55,6 +76,15 @@ void AptCacheFile::Close()
 
     m_packageRecords = 0;
 
+    if (m_descriptionHits + m_descriptionMisses > 0) {
+        g_debug("description cache: %lu hits, %lu misses (%lu%% hit rate)",
+                m_descriptionHits, m_descriptionMisses,
+                m_descriptionHits * 100 / (m_descriptionHits + m_descriptionMisses));
+    }
+    m_descriptionsChecked = false;
+    m_descriptionHits = 0;
+    m_descriptionMisses = 0;
+
     pkgCacheFile::Close();
 
     // Discard all errors to avoid a future failure when opening
@@ -411,42 +441,99 @@ pkgCache::VerIterator AptCacheFile::findCandidateVer(const pkgCache::PkgIterator
     return (*this)[pkg].CandidateVerIter(*this);
 }
 
-std::string AptCacheFile::getShortDescription(const pkgCache::VerIterator &ver)
+static time_t fileMTime(const std::string &fileName)
 {
-    if (ver.end() || ver.FileList().end() || GetPkgRecords() == 0) {
-        return string();
+    struct stat buf;
+    if (fileName.empty() || stat(fileName.c_str(), &buf) != 0) {
+        return 0;
     }
+    return buf.st_mtime;
+}
 
-    pkgCache::DescIterator d = ver.TranslatedDescription();
-    if (d.end()) {
+std::string AptCacheFile::generation()
+{
+    pkgCache *cache = GetPkgCache();
+    if (cache == nullptr) {
         return string();
     }
 
-    pkgCache::DescFileIterator df = d.FileList();
-    if (df.end()) {
-        return string();
-    } else {
-        return m_packageRecords->Lookup(df).ShortDesc();
-    }
+    // the binary cache and the dpkg status change whenever package
+    // lists are refreshed or packages are installed
+    std::stringstream generation;
+    generation << cache->Head().PackageCount << ':'
+               << cache->Head().VersionCount << ':'
+               << fileMTime(_config->FindFile("Dir::Cache::pkgcache")) << ':'
+               << fileMTime(_config->FindFile("Dir::State::status")) << ':'
+               << fileMTime(_config->FindDir("Dir::State::Lists"));
+    return generation.str();
 }
 
-std::string AptCacheFile::getLongDescription(const pkgCache::VerIterator &ver)
+bool AptCacheFile::lookupDescription(const pkgCache::VerIterator &ver,
+                                     std::string &shortDesc,
+                                     std::string &longDesc)
 {
     if (ver.end() || ver.FileList().end() || GetPkgRecords() == 0) {
-        return string();
+        return false;
     }
 
     pkgCache::DescIterator d = ver.TranslatedDescription();
     if (d.end()) {
-        return string();
+        return false;
     }
 
     pkgCache::DescFileIterator df = d.FileList();
     if (df.end()) {
-        return string();
+        return false;
+    }
+
+    // DescFile offsets are only meaningful within one cache generation
+    if (!m_descriptionsChecked) {
+        const std::string current = generation();
+        if (current != descriptionGeneration) {
+            descriptionLru.clear();
+            descriptionIndex.clear();
+            descriptionGeneration = current;
+        }
+        m_descriptionsChecked = true;
+    }
+
+    auto it = descriptionIndex.find(df.Index());
+    if (it != descriptionIndex.end()) {
+        m_descriptionHits++;
+        descriptionLru.splice(descriptionLru.begin(), descriptionLru, it->second);
     } else {
-        return m_packageRecords->Lookup(df).LongDesc();
+        m_descriptionMisses++;
+        pkgRecords::Parser &parser = m_packageRecords->Lookup(df);
+        descriptionLru.push_front({ df.Index(), parser.ShortDesc(), parser.LongDesc() });
+        descriptionIndex[df.Index()] = descriptionLru.begin();
+
+        if (descriptionLru.size() > DESCRIPTION_CACHE_SIZE) {
+            descriptionIndex.erase(descriptionLru.back().descFile);
+            descriptionLru.pop_back();
+        }
+    }
+
+    shortDesc = descriptionLru.front().shortDesc;
+    longDesc = descriptionLru.front().longDesc;
+    return true;
+}
+
+std::string AptCacheFile::getShortDescription(const pkgCache::VerIterator &ver)
+{
+    std::string shortDesc, longDesc;
+    if (!lookupDescription(ver, shortDesc, longDesc)) {
+        return string();
+    }
+    return shortDesc;
+}
+
+std::string AptCacheFile::getLongDescription(const pkgCache::VerIterator &ver)
+{
+    std::string shortDesc, longDesc;
+    if (!lookupDescription(ver, shortDesc, longDesc)) {
+        return string();
     }
+    return longDesc;
 }
 
 std::string AptCacheFile::getLongDescriptionParsed(const pkgCache::VerIterator &ver)
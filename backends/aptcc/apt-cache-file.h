@@ -128,6 +128,12 @@ public:
      */
     std::string getLongDescriptionParsed(const pkgCache::VerIterator &ver);
 
+    /** \return a string that changes whenever the package lists are
+     *  refreshed or packages are installed or removed, so data derived
+     *  from this cache can be kept across jobs
+     */
+    std::string generation();
+
     bool tryToInstall(pkgProblemResolver &Fix,
                       const pkgCache::VerIterator &ver,
                       bool BrokenFix, bool autoInst, bool preserveAuto);
@@ -139,8 +145,20 @@ private:
     void buildPkgRecords();
     static std::string debParser(std::string descr);
 
+    /**
+     * Looks the descriptions of a version up in the description cache
+     * shared by all jobs, parsing the record on a miss
+     * @returns false if the version has no description
+     */
+    bool lookupDescription(const pkgCache::VerIterator &ver,
+                           std::string &shortDesc,
+                           std::string &longDesc);
+
     pkgRecords *m_packageRecords;
     PkBackendJob *m_job;
+    bool m_descriptionsChecked;
+    gulong m_descriptionHits;
+    gulong m_descriptionMisses;
 };
 
 /**
@@ -41,9 +41,12 @@
 #include <iostream>
 #include <memory>
 #include <fstream>
+#include <sstream>
+#include <vector>
 #include <dirent.h>
 
 #include "apt-cache-file.h"
+#include "apt-search-index.h"
 #include "apt-utils.h"
 #include "matcher.h"
 #include "gst-matcher.h"
@@ -55,6 +58,39 @@ using namespace APT;
 
 #define RAMFS_MAGIC     0x858458f6
 
+// Filter attributes of a package version
+enum {
+    PKG_ATTR_KNOWN       = 1 << 0,
+    PKG_ATTR_FREE        = 1 << 1,
+    PKG_ATTR_DEVEL       = 1 << 2,
+    PKG_ATTR_GUI         = 1 << 3,
+    PKG_ATTR_ARCH_NATIVE = 1 << 4,
+    PKG_ATTR_COLLECTION  = 1 << 5,
+    PKG_ATTR_APP_KNOWN   = 1 << 6,
+    PKG_ATTR_APPLICATION = 1 << 7,
+    // depends on the dep cache, so it is never stored
+    PKG_ATTR_INSTALLED   = 1 << 8
+};
+
+// Attributes indexed by version ID, kept for as long as jobs see the same
+// cache; the backend does not run jobs in parallel so no locking is needed
+static std::vector<uint16_t> pkgAttrs;
+static string pkgAttrsGeneration;
+
+static void splitSection(const pkgCache::VerIterator &ver, string &section, string &component)
+{
+    string str = ver.Section() == NULL ? "" : ver.Section();
+
+    size_t found;
+    found = str.find_last_of("/");
+    section = str.substr(found + 1);
+    if(found == str.npos) {
+        component = "main";
+    } else {
+        component = str.substr(0, found);
+    }
+}
+
 AptIntf::AptIntf(PkBackendJob *job) :
     m_job(job),
     m_cancel(false),
@@ -147,6 +183,8 @@ bool AptIntf::init(gchar **localDebs)
         m_cache->Close();
     }
 
+    checkPackageAttributes();
+
     m_interactive = pk_backend_job_get_interactive(m_job);
     if (!m_interactive) {
         // Do not ask about config updates if we are not interactive
@@ -183,134 +221,163 @@ bool AptIntf::cancelled() const
     return m_cancel;
 }
 
+void AptIntf::checkPackageAttributes()
+{
+    pkgCache *cache = m_cache->GetPkgCache();
+    string generation = m_cache->generation();
+    if (cache == nullptr || generation.empty()) {
+        pkgAttrs.clear();
+        pkgAttrsGeneration.clear();
+        return;
+    }
+
+    if (pkgAttrsGeneration.compare(generation) != 0 ||
+            pkgAttrs.size() != cache->Head().VersionCount) {
+        g_debug("package attributes are outdated, resetting them");
+        pkgAttrs.assign(cache->Head().VersionCount, 0);
+        pkgAttrsGeneration = generation;
+    }
+}
+
+uint16_t AptIntf::packageAttributes(const pkgCache::VerIterator &ver)
+{
+    if (ver->ID >= pkgAttrs.size()) {
+        pkgAttrs.resize(ver->ID + 1, 0);
+    }
+
+    uint16_t &attrs = pkgAttrs[ver->ID];
+    if (attrs & PKG_ATTR_KNOWN) {
+        return attrs;
+    }
+
+    attrs = PKG_ATTR_KNOWN;
+
+    // packages for "all" architectures are native too
+    if (strcmp(ver.Arch(), "all") == 0 ||
+            strcmp(ver.Arch(), _config->Find("APT::Architecture").c_str()) == 0) {
+        attrs |= PKG_ATTR_ARCH_NATIVE;
+    }
+
+    string section, component;
+    splitSection(ver, section, component);
+
+    string pkgName = ver.ParentPkg().Name();
+    if (ends_with(pkgName, "-dev") ||
+            ends_with(pkgName, "-dbg") ||
+            !section.compare("devel") ||
+            !section.compare("libdevel")) {
+        attrs |= PKG_ATTR_DEVEL;
+    }
+
+    if (!section.compare("x11") || !section.compare("gnome") ||
+            !section.compare("kde") || !section.compare("graphics")) {
+        attrs |= PKG_ATTR_GUI;
+    }
+
+    // Must be in main and universe to be free
+    if (!component.compare("main") || !component.compare("universe")) {
+        attrs |= PKG_ATTR_FREE;
+    }
+
+    if (!component.compare("metapackages")) {
+        attrs |= PKG_ATTR_COLLECTION;
+    }
+
+    return attrs;
+}
+
 bool AptIntf::matchPackage(const pkgCache::VerIterator &ver, PkBitfield filters)
 {
     if (filters != 0) {
         const pkgCache::PkgIterator &pkg = ver.ParentPkg();
-        bool installed = false;
+        uint16_t attrs = packageAttributes(ver);
+        uint16_t want = 0;
+        uint16_t reject = 0;
 
         // Check if the package is installed
         if (pkg->CurrentState == pkgCache::State::Installed && pkg.CurrentVer() == ver) {
-            installed = true;
+            attrs |= PKG_ATTR_INSTALLED;
         }
 
-        // if we are on multiarch check also the arch filter
-        if (m_isMultiArch && pk_bitfield_contain(filters, PK_FILTER_ENUM_ARCH)/* && !installed*/) {
-            // don't emit the package if it does not match
-            // the native architecture
-            if (strcmp(ver.Arch(), "all") != 0 &&
-                    strcmp(ver.Arch(), _config->Find("APT::Architecture").c_str()) != 0) {
-                return false;
-            }
+        // if we are on multiarch check also the arch filter, don't emit the
+        // package if it does not match the native architecture
+        if (m_isMultiArch && pk_bitfield_contain(filters, PK_FILTER_ENUM_ARCH)) {
+            want |= PKG_ATTR_ARCH_NATIVE;
         }
 
-        std::string str = ver.Section() == NULL ? "" : ver.Section();
-        std::string section, component;
-
-        size_t found;
-        found = str.find_last_of("/");
-        section = str.substr(found + 1);
-        if(found == str.npos) {
-            component = "main";
-        } else {
-            component = str.substr(0, found);
-        }
-
-        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_INSTALLED) && installed) {
-            return false;
-        } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_INSTALLED) && !installed) {
-            return false;
+        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_INSTALLED)) {
+            reject |= PKG_ATTR_INSTALLED;
+        } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_INSTALLED)) {
+            want |= PKG_ATTR_INSTALLED;
         }
 
         if (pk_bitfield_contain(filters, PK_FILTER_ENUM_DEVELOPMENT)) {
-            // if ver.end() means unknow
-            // strcmp will be true when it's different than devel
-            std::string pkgName = pkg.Name();
-            if (!ends_with(pkgName, "-dev") &&
-                    !ends_with(pkgName, "-dbg") &&
-                    section.compare("devel") &&
-                    section.compare("libdevel")) {
-                return false;
-            }
+            want |= PKG_ATTR_DEVEL;
         } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_DEVELOPMENT)) {
-            std::string pkgName = pkg.Name();
-            if (ends_with(pkgName, "-dev") ||
-                    ends_with(pkgName, "-dbg") ||
-                    !section.compare("devel") ||
-                    !section.compare("libdevel")) {
-                return false;
-            }
+            reject |= PKG_ATTR_DEVEL;
         }
 
         if (pk_bitfield_contain(filters, PK_FILTER_ENUM_GUI)) {
-            // if ver.end() means unknow
-            // strcmp will be true when it's different than x11
-            if (section.compare("x11") && section.compare("gnome") &&
-                    section.compare("kde") && section.compare("graphics")) {
-                return false;
-            }
+            want |= PKG_ATTR_GUI;
         } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_GUI)) {
-            if (!section.compare("x11") || !section.compare("gnome") ||
-                    !section.compare("kde") || !section.compare("graphics")) {
-                return false;
-            }
+            reject |= PKG_ATTR_GUI;
         }
 
         if (pk_bitfield_contain(filters, PK_FILTER_ENUM_FREE)) {
-            if (component.compare("main") != 0 &&
-                    component.compare("universe") != 0) {
-                // Must be in main and universe to be free
-                return false;
-            }
+            want |= PKG_ATTR_FREE;
         } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_FREE)) {
-            if (component.compare("main") == 0 ||
-                    component.compare("universe") == 0) {
-                // Must not be in main or universe to be free
-                return false;
-            }
+            reject |= PKG_ATTR_FREE;
         }
 
-        // Check for supported packages
-        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_SUPPORTED)) {
-            if (!packageIsSupported(ver, component)) {
-                return false;
-            }
-        } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_SUPPORTED)) {
-            if (packageIsSupported(ver, component)) {
+        // TODO test this one..
+#if 0
+        // I couldn'tfind any packages with the metapackages component, and I
+        // think the check is the wrong way around; PK_FILTER_ENUM_COLLECTIONS
+        // is for virtual group packages -- hughsie
+        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_COLLECTIONS)) {
+            reject |= PKG_ATTR_COLLECTION;
+        } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_COLLECTIONS)) {
+            want |= PKG_ATTR_COLLECTION;
+        }
+#endif
+
+        if ((attrs & want) != want || (attrs & reject) != 0) {
+            return false;
+        }
+
+        // Check for supported packages, this depends on the
+        // trust state of the fetcher so it is not cached
+        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_SUPPORTED) ||
+                pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_SUPPORTED)) {
+            string section, component;
+            splitSection(ver, section, component);
+            if (packageIsSupported(ver, component) !=
+                    pk_bitfield_contain(filters, PK_FILTER_ENUM_SUPPORTED)) {
                 return false;
             }
         }
 
         // Check for applications, if they have files with .desktop
-        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_APPLICATION)) {
+        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_APPLICATION) ||
+                pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_APPLICATION)) {
             // We do not support checking if it is an Application
             // if NOT installed
-            if (!installed || !isApplication(ver)) {
+            if (!(attrs & PKG_ATTR_INSTALLED)) {
                 return false;
             }
-        } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_APPLICATION)) {
-            // We do not support checking if it is an Application
-            // if NOT installed
-            if (!installed || isApplication(ver)) {
-                return false;
-            }
-        }
 
-        // TODO test this one..
-#if 0
-        // I couldn'tfind any packages with the metapackages component, and I
-        // think the check is the wrong way around; PK_FILTER_ENUM_COLLECTIONS
-        // is for virtual group packages -- hughsie
-        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_COLLECTIONS)) {
-            if (!component.compare("metapackages")) {
-                return false;
+            uint16_t &cached = pkgAttrs[ver->ID];
+            if (!(cached & PKG_ATTR_APP_KNOWN)) {
+                cached |= PKG_ATTR_APP_KNOWN;
+                if (isApplication(ver)) {
+                    cached |= PKG_ATTR_APPLICATION;
+                }
             }
-        } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_COLLECTIONS)) {
-            if (component.compare("metapackages")) {
+            if (((cached & PKG_ATTR_APPLICATION) != 0) !=
+                    pk_bitfield_contain(filters, PK_FILTER_ENUM_APPLICATION)) {
                 return false;
             }
         }
-#endif
     }
     return true;
 }
@@ -1111,6 +1178,54 @@ PkgList AptIntf::searchPackageName(gchar *search)
     return output;
 }
 
+// Splits a search into the words the Matcher will use, the Matcher only
+// looks at the first alternative; fails for anything but plain words
+static bool searchTerms(const string &search, vector<string> &terms)
+{
+    if (search.find_first_of("\"~()!") != string::npos) {
+        return false;
+    }
+
+    std::istringstream stream(search.substr(0, search.find('|')));
+    string term;
+    while (stream >> term) {
+        terms.push_back(term);
+    }
+    return !terms.empty();
+}
+
+void AptIntf::matchPackageDetails(Matcher *matcher, const pkgCache::PkgIterator &pkg, PkgList &output)
+{
+    // Ignore packages that exist only due to dependencies.
+    if (pkg.VersionList().end() && pkg.ProvidesList().end()) {
+        return;
+    }
+
+    const pkgCache::VerIterator &ver = m_cache->findVer(pkg);
+    if (ver.end() == false) {
+        if (matcher->matches(pkg.Name()) ||
+                matcher->matches((*m_cache).getLongDescription(ver))) {
+            // The package matched
+            output.push_back(ver);
+        }
+    } else if (matcher->matches(pkg.Name())) {
+        // The package is virtual and MATCHED the name
+        // Don't insert virtual packages instead add what it provides
+
+        // iterate over the provides list
+        for (pkgCache::PrvIterator Prv = pkg.ProvidesList(); Prv.end() == false; ++Prv) {
+            const pkgCache::VerIterator &ownerVer = m_cache->findVer(Prv.OwnerPkg());
+
+            // check to see if the provided package isn't virtual too
+            if (ownerVer.end() == false) {
+                // we add the package now because we will need to
+                // remove duplicates later anyway
+                output.push_back(ownerVer);
+            }
+        }
+    }
+}
+
 PkgList AptIntf::searchPackageDetails(gchar *search)
 {
     PkgList output;
@@ -1122,39 +1237,33 @@ PkgList AptIntf::searchPackageDetails(gchar *search)
         return output;
     }
 
-    for (pkgCache::PkgIterator pkg = m_cache->GetPkgCache()->PkgBegin(); !pkg.end(); ++pkg) {
-        if (m_cancel) {
-            break;
-        }
-        // Ignore packages that exist only due to dependencies.
-        if (pkg.VersionList().end() && pkg.ProvidesList().end()) {
-            continue;
-        }
+    // Narrow the search down with the word index, the regexes
+    // then only verify the candidates
+    vector<string> terms;
+    vector<uint32_t> ids;
+    AptSearchIndex *index = nullptr;
+    if (searchTerms(search, terms)) {
+        index = AptSearchIndex::get(m_cache, m_cancel);
+    }
 
-        const pkgCache::VerIterator &ver = m_cache->findVer(pkg);
-        if (ver.end() == false) {
-            if (matcher->matches(pkg.Name()) ||
-                    matcher->matches((*m_cache).getLongDescription(ver))) {
-                // The package matched
-                output.push_back(ver);
+    pkgCache *cache = m_cache->GetPkgCache();
+    if (index && index->lookup(terms, ids)) {
+        for (const pkgCache::PkgIterator &pkg : AptSearchIndex::packages(cache, ids)) {
+            if (m_cancel) {
+                break;
             }
-        } else if (matcher->matches(pkg.Name())) {
-            // The package is virtual and MATCHED the name
-            // Don't insert virtual packages instead add what it provides
-
-            // iterate over the provides list
-            for (pkgCache::PrvIterator Prv = pkg.ProvidesList(); Prv.end() == false; ++Prv) {
-                const pkgCache::VerIterator &ownerVer = m_cache->findVer(Prv.OwnerPkg());
-
-                // check to see if the provided package isn't virtual too
-                if (ownerVer.end() == false) {
-                    // we add the package now because we will need to
-                    // remove duplicates later anyway
-                    output.push_back(ownerVer);
-                }
+            matchPackageDetails(matcher, pkg, output);
+        }
+    } else {
+        for (pkgCache::PkgIterator pkg = cache->PkgBegin(); !pkg.end(); ++pkg) {
+            if (m_cancel) {
+                break;
             }
+            matchPackageDetails(matcher, pkg, output);
         }
     }
+
+    delete matcher;
     return output;
 }
 
@@ -247,6 +247,22 @@ private:
     bool packageIsSupported(const pkgCache::VerIterator &verIter, string component);
     bool isApplication(const pkgCache::VerIterator &verIter);
 
+    /**
+     *  Makes sure the cached package attributes belong to the open cache
+     */
+    void checkPackageAttributes();
+
+    /**
+     *  Adds the package to output if its name or description matches
+     */
+    void matchPackageDetails(Matcher *matcher, const pkgCache::PkgIterator &pkg, PkgList &output);
+
+    /**
+     *  Returns the PKG_ATTR_* bits of a version, computing them the
+     *  first time the version is seen in this cache generation
+     */
+    uint16_t packageAttributes(const pkgCache::VerIterator &ver);
+
     /**
      *  interprets dpkg status fd
      */
@@ -0,0 +1,259 @@
+/* apt-search-index.cpp
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "apt-search-index.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "apt-cache-file.h"
+
+#define SEARCH_INDEX_DIR    LOCALSTATEDIR "/cache/PackageKit/aptcc"
+#define SEARCH_INDEX_FILE   SEARCH_INDEX_DIR "/details.idx"
+#define SEARCH_INDEX_MAGIC  "PackageKit aptcc details 1"
+
+using std::string;
+using std::vector;
+
+// the index is kept for as long as jobs see the same cache
+static AptSearchIndex *searchIndex = nullptr;
+
+AptSearchIndex::AptSearchIndex(const string &generation) :
+    m_generation(generation)
+{
+}
+
+AptSearchIndex* AptSearchIndex::get(AptCacheFile *cache, const bool &cancel)
+{
+    string generation = cache->generation();
+    if (generation.empty()) {
+        return nullptr;
+    }
+
+    if (searchIndex && searchIndex->m_generation == generation) {
+        return searchIndex;
+    }
+
+    delete searchIndex;
+    searchIndex = new AptSearchIndex(generation);
+    if (searchIndex->load()) {
+        return searchIndex;
+    }
+
+    g_debug("building the search index for cache generation %s", generation.c_str());
+    if (!searchIndex->build(cache, cancel)) {
+        delete searchIndex;
+        searchIndex = nullptr;
+        return nullptr;
+    }
+
+    if (!searchIndex->save()) {
+        g_warning("failed to save the search index to %s", SEARCH_INDEX_FILE);
+    }
+    return searchIndex;
+}
+
+bool AptSearchIndex::lookup(const vector<string> &terms, vector<uint32_t> &ids) const
+{
+    vector<string> words;
+
+    // a plain word always matches within a single token, anything
+    // else could span several of them
+    for (const string &term : terms) {
+        string word;
+        for (const char c : term) {
+            if (!g_ascii_isalnum(c)) {
+                return false;
+            }
+            word += g_ascii_tolower(c);
+        }
+        if (word.empty()) {
+            return false;
+        }
+        words.push_back(word);
+    }
+
+    if (words.empty()) {
+        return false;
+    }
+
+    ids.clear();
+    for (auto it = words.begin(); it != words.end(); ++it) {
+        vector<uint32_t> matches;
+        for (const auto &posting : m_postings) {
+            if (posting.first.find(*it) != string::npos) {
+                matches.insert(matches.end(), posting.second.begin(), posting.second.end());
+            }
+        }
+        std::sort(matches.begin(), matches.end());
+        matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
+
+        if (it == words.begin()) {
+            ids.swap(matches);
+        } else {
+            vector<uint32_t> both;
+            std::set_intersection(ids.begin(), ids.end(),
+                                  matches.begin(), matches.end(),
+                                  std::back_inserter(both));
+            ids.swap(both);
+        }
+
+        if (ids.empty()) {
+            break;
+        }
+    }
+    return true;
+}
+
+vector<pkgCache::PkgIterator> AptSearchIndex::packages(pkgCache *cache, const vector<uint32_t> &ids)
+{
+    vector<pkgCache::PkgIterator> pkgs;
+
+    // the index stores the sequential package IDs, which are not
+    // offsets into the package array, so walk the cache once to map them
+    vector<bool> wanted(cache->Head().PackageCount, false);
+    for (const uint32_t id : ids) {
+        if (id < wanted.size()) {
+            wanted[id] = true;
+        }
+    }
+
+    for (pkgCache::PkgIterator pkg = cache->PkgBegin(); !pkg.end(); ++pkg) {
+        if (pkg->ID < wanted.size() && wanted[pkg->ID]) {
+            pkgs.push_back(pkg);
+        }
+    }
+    return pkgs;
+}
+
+bool AptSearchIndex::load()
+{
+    std::ifstream in(SEARCH_INDEX_FILE);
+    if (!in) {
+        return false;
+    }
+
+    string line;
+    if (!getline(in, line) || line != SEARCH_INDEX_MAGIC ||
+            !getline(in, line) || line != m_generation) {
+        return false;
+    }
+
+    while (getline(in, line)) {
+        size_t found = line.find('\t');
+        if (found == string::npos) {
+            m_postings.clear();
+            return false;
+        }
+
+        vector<uint32_t> &ids = m_postings[line.substr(0, found)];
+        std::istringstream stream(line.substr(found + 1));
+        uint32_t id;
+        while (stream >> id) {
+            ids.push_back(id);
+        }
+    }
+    return true;
+}
+
+bool AptSearchIndex::save() const
+{
+    if (g_mkdir_with_parents(SEARCH_INDEX_DIR, 0755) != 0) {
+        return false;
+    }
+
+    // write to a temporary file so readers never see half an index
+    string tmpName = string(SEARCH_INDEX_FILE) + ".tmp";
+    {
+        std::ofstream out(tmpName.c_str(), std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+
+        out << SEARCH_INDEX_MAGIC << '\n' << m_generation << '\n';
+        for (const auto &posting : m_postings) {
+            out << posting.first << '\t';
+            for (const uint32_t id : posting.second) {
+                out << id << ' ';
+            }
+            out << '\n';
+        }
+
+        if (!out) {
+            g_unlink(tmpName.c_str());
+            return false;
+        }
+    }
+
+    return g_rename(tmpName.c_str(), SEARCH_INDEX_FILE) == 0;
+}
+
+bool AptSearchIndex::build(AptCacheFile *cache, const bool &cancel)
+{
+    for (pkgCache::PkgIterator pkg = cache->GetPkgCache()->PkgBegin(); !pkg.end(); ++pkg) {
+        if (cancel) {
+            return false;
+        }
+        // Ignore packages that exist only due to dependencies.
+        if (pkg.VersionList().end() && pkg.ProvidesList().end()) {
+            continue;
+        }
+
+        addText(pkg.Name(), pkg->ID);
+
+        const pkgCache::VerIterator &ver = cache->findVer(pkg);
+        if (ver.end() == false) {
+            addText(cache->getLongDescription(ver), pkg->ID);
+        }
+    }
+
+    // the cache is walked in hash order, lookups need sorted lists
+    for (auto &posting : m_postings) {
+        std::sort(posting.second.begin(), posting.second.end());
+        posting.second.erase(std::unique(posting.second.begin(), posting.second.end()),
+                             posting.second.end());
+    }
+    return true;
+}
+
+void AptSearchIndex::addText(const string &text, uint32_t id)
+{
+    string token;
+
+    // bytes of UTF-8 sequences are kept as part of the word
+    for (size_t i = 0; i <= text.size(); ++i) {
+        const unsigned char c = i < text.size() ? text[i] : ' ';
+        if (g_ascii_isalnum(c) || c >= 0x80) {
+            token += g_ascii_tolower(c);
+            continue;
+        }
+
+        if (!token.empty()) {
+            vector<uint32_t> &ids = m_postings[token];
+            if (ids.empty() || ids.back() != id) {
+                ids.push_back(id);
+            }
+            token.clear();
+        }
+    }
+}
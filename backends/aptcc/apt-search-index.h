@@ -0,0 +1,73 @@
+/* apt-search-index.h
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef APT_SEARCH_INDEX_H
+#define APT_SEARCH_INDEX_H
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <apt-pkg/pkgcache.h>
+
+class AptCacheFile;
+
+/**
+ * Inverted index of the words in package names and long descriptions,
+ * used to narrow SearchDetails down before running the regexes
+ */
+class AptSearchIndex
+{
+public:
+    /**
+     * Returns the index for the given cache, loading it from disk or
+     * building it if the cache generation changed
+     * @returns nullptr if the index could not be built
+     */
+    static AptSearchIndex* get(AptCacheFile *cache, const bool &cancel);
+
+    /**
+     * Fills ids with the packages whose name or description contain
+     * every term, which is a superset of what the Matcher accepts
+     * @returns false if a term is not a plain word and the whole
+     * cache has to be searched instead
+     */
+    bool lookup(const std::vector<std::string> &terms, std::vector<uint32_t> &ids) const;
+
+    /**
+     * Resolves the ids returned by lookup() to the packages of the
+     * cache, in the order a full scan of the cache visits them
+     */
+    static std::vector<pkgCache::PkgIterator> packages(pkgCache *cache, const std::vector<uint32_t> &ids);
+
+private:
+    AptSearchIndex(const std::string &generation);
+
+    bool load();
+    bool save() const;
+    bool build(AptCacheFile *cache, const bool &cancel);
+    void addText(const std::string &text, uint32_t id);
+
+    std::string m_generation;
+    std::map<std::string, std::vector<uint32_t> > m_postings;
+};
+
+#endif
@@ -0,0 +1,24 @@
+#include <pk-backend.h>
+#include <pk-backend-job.h>
+
+PkRoleEnum
+pk_backend_job_get_role (PkBackendJob *job)
+{
+	return PK_ROLE_ENUM_SEARCH_DETAILS;
+}
+
+void
+pk_backend_job_set_status (PkBackendJob *job, PkStatusEnum status)
+{
+}
+
+void
+pk_backend_job_set_percentage (PkBackendJob *job, guint percentage)
+{
+}
+
+void
+pk_backend_job_error_code (PkBackendJob *job,
+		PkErrorEnum error_code, const gchar *format, ...)
+{
+}
@@ -0,0 +1,92 @@
+#include <glib.h>
+
+#include <string>
+#include <vector>
+
+#include <apt-pkg/configuration.h>
+#include <apt-pkg/init.h>
+#include <apt-pkg/pkgsystem.h>
+
+#include "apt-cache-file.h"
+#include "apt-search-index.h"
+#include "matcher.h"
+
+using std::string;
+using std::vector;
+
+static AptCacheFile *cache = nullptr;
+
+static bool
+match_details (Matcher &matcher, const pkgCache::PkgIterator &pkg)
+{
+	if (pkg.VersionList ().end () && pkg.ProvidesList ().end ())
+		return false;
+	if (matcher.matches (pkg.Name ()))
+		return true;
+
+	const pkgCache::VerIterator &ver = cache->findVer (pkg);
+	return !ver.end () && matcher.matches (cache->getLongDescription (ver));
+}
+
+/* the index may only narrow the search down, never change its result */
+static void
+test_search (gconstpointer data)
+{
+	const gchar *search = (const gchar *) data;
+	pkgCache *pkgcache = cache->GetPkgCache ();
+	Matcher matcher (search);
+	vector<string> full, indexed, terms;
+	vector<uint32_t> ids;
+	AptSearchIndex *index;
+	bool cancel = false;
+
+	g_assert_false (matcher.hasError ());
+
+	for (pkgCache::PkgIterator pkg = pkgcache->PkgBegin (); !pkg.end (); ++pkg) {
+		if (match_details (matcher, pkg))
+			full.push_back (pkg.FullName (true));
+	}
+
+	index = AptSearchIndex::get (cache, cancel);
+	g_assert_nonnull (index);
+
+	gchar **words = g_strsplit (search, " ", -1);
+	for (guint i = 0; words[i] != NULL; i++)
+		terms.push_back (words[i]);
+	g_strfreev (words);
+	g_assert_true (index->lookup (terms, ids));
+	g_assert_cmpuint (ids.size (), <=, pkgcache->Head ().PackageCount);
+
+	for (const pkgCache::PkgIterator &pkg : AptSearchIndex::packages (pkgcache, ids)) {
+		if (match_details (matcher, pkg))
+			indexed.push_back (pkg.FullName (true));
+	}
+
+	g_test_message ("'%s': %zu of %u packages checked, %zu matches",
+			search, ids.size (), pkgcache->Head ().PackageCount,
+			full.size ());
+	g_assert_cmpuint (indexed.size (), ==, full.size ());
+	for (size_t i = 0; i < full.size (); i++)
+		g_assert_cmpstr (indexed[i].c_str (), ==, full[i].c_str ());
+}
+
+int
+main (int argc, char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	/* needs the apt cache of the machine running the tests */
+	if (!pkgInitConfig (*_config) || !pkgInitSystem (*_config, _system))
+		return 77;
+	cache = new AptCacheFile (NULL);
+	if (!cache->Open (false) || cache->GetPkgCache ()->Head ().PackageCount == 0)
+		return 77;
+
+	g_test_add_data_func ("/aptcc/search-index/word", "python", test_search);
+	g_test_add_data_func ("/aptcc/search-index/words", "text editor", test_search);
+	g_test_add_data_func ("/aptcc/search-index/prefix", "lib", test_search);
+
+	int ret = g_test_run ();
+	delete cache;
+	return ret;
+}
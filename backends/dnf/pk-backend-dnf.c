@@ -1645,6 +1645,145 @@ pk_backend_refresh_repo (PkBackendJob *job,
 	return dnf_state_done (state, error);
 }
 
+typedef struct {
+	PkBackendJob	*job;
+	DnfState	*state;		/* shared by all the repos */
+	GMutex		 mutex;
+	GPtrArray	*items;		/* of PkBackendDnfRefreshItem */
+	gboolean	 force;
+} PkBackendDnfRefreshData;
+
+typedef struct {
+	PkBackendDnfRefreshData	*data;
+	DnfRepo		*repo;
+	guint		 percentage;
+	GError		*error;
+} PkBackendDnfRefreshItem;
+
+/**
+ * pk_backend_refresh_repo_percentage_changed_cb:
+ */
+static void
+pk_backend_refresh_repo_percentage_changed_cb (DnfState *state,
+					       guint value,
+					       PkBackendDnfRefreshItem *item)
+{
+	PkBackendDnfRefreshData *data = item->data;
+	guint total = 0;
+	guint i;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&data->mutex);
+
+	/* the job progress is the average of all the repos */
+	item->percentage = value;
+	for (i = 0; i < data->items->len; i++) {
+		PkBackendDnfRefreshItem *tmp = g_ptr_array_index (data->items, i);
+		total += tmp->percentage;
+	}
+	dnf_state_set_percentage (data->state, total / data->items->len);
+}
+
+/**
+ * pk_backend_refresh_repo_worker:
+ */
+static void
+pk_backend_refresh_repo_worker (PkBackendDnfRefreshItem *item,
+				PkBackendDnfRefreshData *data)
+{
+	g_autoptr(DnfState) state = dnf_state_new ();
+
+	dnf_state_set_cancellable (state, dnf_state_get_cancellable (data->state));
+	g_signal_connect (state, "percentage-changed",
+			  G_CALLBACK (pk_backend_refresh_repo_percentage_changed_cb),
+			  item);
+
+	/* delete content even if up to date */
+	if (data->force) {
+		g_debug ("Deleting contents of %s as forced", dnf_repo_get_id (item->repo));
+		if (!dnf_repo_clean (item->repo, &item->error))
+			return;
+	}
+
+	/* check and download */
+	pk_backend_refresh_repo (data->job, item->repo, state, &item->error);
+}
+
+/**
+ * pk_backend_refresh_repos:
+ *
+ * Refreshes up to MaxParallelRefresh repos at the same time. A repo that
+ * fails does not stop the others, and all the failures are reported at the
+ * end.
+ */
+static gboolean
+pk_backend_refresh_repos (PkBackendJob *job,
+			  GPtrArray *repos,
+			  gboolean force,
+			  DnfState *state,
+			  GError **error)
+{
+	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
+	PkBackendDnfPrivate *priv = pk_backend_get_user_data (job_data->backend);
+	PkBackendDnfRefreshData data = { 0 };
+	GThreadPool *pool;
+	GString *failed = NULL;
+	gint max_threads;
+	gint code = 0;
+	guint i;
+	g_autoptr(GPtrArray) items = NULL;
+
+	max_threads = g_key_file_get_integer (priv->conf, "Daemon", "MaxParallelRefresh", NULL);
+	if (max_threads < 1)
+		max_threads = 4;
+
+	items = g_ptr_array_new_with_free_func (g_free);
+	for (i = 0; i < repos->len; i++) {
+		PkBackendDnfRefreshItem *item = g_new0 (PkBackendDnfRefreshItem, 1);
+		item->data = &data;
+		item->repo = g_ptr_array_index (repos, i);
+		g_ptr_array_add (items, item);
+	}
+
+	data.job = job;
+	data.state = state;
+	data.items = items;
+	data.force = force;
+	g_mutex_init (&data.mutex);
+
+	g_debug ("refreshing %u repos using %i threads", repos->len, max_threads);
+	pool = g_thread_pool_new ((GFunc) pk_backend_refresh_repo_worker, &data,
+				  max_threads, TRUE, NULL);
+	for (i = 0; i < items->len; i++)
+		g_thread_pool_push (pool, g_ptr_array_index (items, i), NULL);
+	g_thread_pool_free (pool, FALSE, TRUE);
+	g_mutex_clear (&data.mutex);
+
+	/* collect the errors of the repos that failed */
+	for (i = 0; i < items->len; i++) {
+		PkBackendDnfRefreshItem *item = g_ptr_array_index (items, i);
+		if (item->error == NULL)
+			continue;
+		g_warning ("failed to refresh %s: %s",
+			   dnf_repo_get_id (item->repo), item->error->message);
+		if (failed == NULL) {
+			failed = g_string_new (NULL);
+			code = item->error->code;
+		} else {
+			g_string_append (failed, "; ");
+		}
+		g_string_append_printf (failed, "%s: %s",
+					dnf_repo_get_id (item->repo),
+					item->error->message);
+		g_error_free (item->error);
+	}
+	if (failed != NULL) {
+		g_set_error_literal (error, DNF_ERROR, code, failed->str);
+		g_string_free (failed, TRUE);
+		return FALSE;
+	}
+
+	return dnf_state_finished (state, error);
+}
+
 /**
  * pk_backend_refresh_cache_thread:
  */
@@ -1664,6 +1803,7 @@ pk_backend_refresh_cache_thread (PkBackendJob *job,
 	guint i;
 	g_autoptr(DnfSack) sack = NULL;
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GError) error_refresh = NULL;
 	g_autoptr(GPtrArray) refresh_repos = NULL;
 
 	/* set state */
@@ -1735,36 +1875,15 @@ pk_backend_refresh_cache_thread (PkBackendJob *job,
 		return;
 	}
 
-	/* refresh each repo */
+	/* refresh the repos, but keep the metadata of the ones that worked */
 	state_local = dnf_state_get_child (job_data->state);
-	dnf_state_set_number_steps (state_local, refresh_repos->len);
-	for (i = 0; i < refresh_repos->len; i++) {
-		repo = g_ptr_array_index (refresh_repos, i);
-
-		/* delete content even if up to date */
-		if (force) {
-			g_debug ("Deleting contents of %s as forced", dnf_repo_get_id (repo));
-			ret = dnf_repo_clean (repo, &error);
-			if (!ret) {
-				pk_backend_job_error_code (job, error->code, "%s", error->message);
-				return;
-			}
-		}
-
-		/* check and download */
-		state_loop = dnf_state_get_child (state_local);
-		ret = pk_backend_refresh_repo (job, repo, state_loop, &error);
-		if (!ret) {
-			pk_backend_job_error_code (job, error->code, "%s", error->message);
-			return;
-		}
-
-		/* done */
-		ret = dnf_state_done (state_local, &error);
-		if (!ret) {
-			pk_backend_job_error_code (job, error->code, "%s", error->message);
+	if (!pk_backend_refresh_repos (job, refresh_repos, force,
+				       state_local, &error_refresh)) {
+		if (g_cancellable_is_cancelled (pk_backend_job_get_cancellable (job))) {
+			pk_backend_job_error_code (job, error_refresh->code, "%s", error_refresh->message);
 			return;
 		}
+		dnf_state_finished (state_local, NULL);
 	}
 
 	/* done */
@@ -1790,6 +1909,10 @@ pk_backend_refresh_cache_thread (PkBackendJob *job,
 		pk_backend_job_error_code (job, error->code, "%s", error->message);
 		return;
 	}
+
+	/* only now say which repos could not be refreshed */
+	if (error_refresh != NULL)
+		pk_backend_job_error_code (job, error_refresh->code, "%s", error_refresh->message);
 }
 
 /**
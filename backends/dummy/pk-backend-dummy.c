@@ -935,8 +935,29 @@ pk_backend_remove_packages (PkBackend *backend, PkBackendJob *job,
 static void
 pk_backend_search_details_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
 {
+	guint i;
+	PkBitfield filters;
+	g_autofree gchar **search = NULL;
+
+	g_variant_get (params, "(t^a&s)",
+		       &filters,
+		       &search);
+
 	pk_backend_job_set_status (job, PK_STATUS_ENUM_QUERY);
 	pk_backend_job_set_allow_cancel (job, TRUE);
+
+	/* a large result set for the self tests */
+	if (g_strcmp0 (search[0], "bulk") == 0) {
+		for (i = 0; i < 20000; i++) {
+			g_autofree gchar *package_id = NULL;
+			package_id = g_strdup_printf ("bulk%05u;1.0-1;noarch;dummy", i);
+			pk_backend_job_package (job, PK_INFO_ENUM_AVAILABLE,
+						package_id,
+						"A package of the bulk results test");
+		}
+		return;
+	}
+
 	pk_backend_job_package (job, PK_INFO_ENUM_AVAILABLE,
 				"vips-doc;7.12.4-2.fc8;noarch;linva",
 				"The vips \"documentation\" package.");
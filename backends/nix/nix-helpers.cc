@@ -19,22 +19,121 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <sys/stat.h>
+#include <algorithm>
+
+#include <nix/attr-path.hh>
+
 #include "nix-helpers.hh"
 
+#define NIX_DRV_INDEX_DIR	"/var/cache/PackageKit/nix"
+#define NIX_DRV_INDEX_FILENAME	NIX_DRV_INDEX_DIR "/derivations.idx"
+#define NIX_DRV_INDEX_MAGIC	"PackageKit nix derivations 2"
+#define NIX_DRV_INDEX_FIELDS	8
+#define NIX_DRV_INDEX_NO_LIST	"-"
+
+// index drvs by attrpath, and by name without the version
+void
+nix_build_drv_maps (DrvInfos & drvs, NixDrvMaps & maps)
+{
+	maps.attrPaths.clear ();
+	maps.names.clear ();
+
+	maps.attrPaths.reserve (drvs.size ());
+	maps.names.reserve (drvs.size ());
+
+	for (auto & drv : drvs)
+	{
+		// like a linear scan, the first drv wins for duplicates
+		maps.attrPaths.emplace (drv.attrPath, &drv);
+		maps.names[DrvName (drv.name).name].push_back (&drv);
+	}
+}
+
+// the full names of drvs, used to check if a drv is installed
+std::unordered_set<string>
+nix_drv_names (DrvInfos & drvs)
+{
+	std::unordered_set<string> names;
+
+	for (auto & drv : drvs)
+		names.insert (drv.name);
+
+	return names;
+}
+
+// the info to emit for a drv, or PK_INFO_ENUM_UNKNOWN if the installed
+// filters exclude it
+PkInfoEnum
+nix_drv_installed_info (const std::unordered_set<string> & installedNames, DrvInfo & drv, PkBitfield filters)
+{
+	auto info = PK_INFO_ENUM_AVAILABLE;
+
+	if (installedNames.count (drv.name))
+		info = PK_INFO_ENUM_INSTALLED;
+
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED) && info != PK_INFO_ENUM_INSTALLED)
+		return PK_INFO_ENUM_UNKNOWN;
+
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED) && info == PK_INFO_ENUM_INSTALLED)
+		return PK_INFO_ENUM_UNKNOWN;
+
+	return info;
+}
+
+// find the drv with the same name that an installed drv would be updated
+// to: the highest priority, then the highest version, and never a lower
+// priority than the installed one
+DrvInfo*
+nix_find_update (EvalState & state, NixDrvMaps & maps, DrvInfo & installed, string & bestVersion)
+{
+	DrvName drvName (installed.name);
+	DrvInfo* bestElem = NULL;
+
+	auto candidates = maps.names.find (drvName.name);
+	if (candidates == maps.names.end ())
+		return NULL;
+
+	for (auto j : candidates->second)
+	{
+		if (comparePriorities (state, installed, *j) > 0)
+			continue;
+
+		DrvName newName (j->name);
+		if (compareVersions (drvName.version, newName.version) >= 0)
+			continue;
+
+		int d2 = -1;
+		if (bestElem != NULL)
+		{
+			d2 = comparePriorities (state, *bestElem, *j);
+			if (d2 == 0)
+				d2 = compareVersions (bestVersion, newName.version);
+		}
+		if (d2 < 0)
+		{
+			bestElem = j;
+			bestVersion = newName.version;
+		}
+	}
+
+	return bestElem;
+}
+
 // find drv based on attrpath and system
 DrvInfo
-nix_find_drv (EvalState & state, DrvInfos drvs, gchar* package_id)
+nix_find_drv (EvalState & state, NixDrvMaps & maps, gchar* package_id)
 {
-	gchar** package_id_parts = pk_package_id_split (package_id);
+	g_auto(GStrv) package_id_parts = pk_package_id_split (package_id);
 
 	// string name (package_id_parts[0]);
 	// string version (package_id_parts[1]);
 	string system (package_id_parts[2]);
 	string attrPath (package_id_parts[3]);
 
-	for (auto drv : drvs)
-		if (drv.attrPath == attrPath && drv.system == system)
-			return drv;
+	auto i = maps.attrPaths.find (attrPath);
+	if (i != maps.attrPaths.end () && i->second->system == system)
+		return *i->second;
 
 	DrvInfo drv (state);
 	return drv;
@@ -54,20 +153,68 @@ nix_drv_package_id (DrvInfo & drv)
 	);
 }
 
-// get all drvs from list of ids
+// drvs loaded from the index have no derivation path until evaluated
+static bool
+nix_drv_is_indexed (DrvInfo & drv)
+{
+	return drv.attrPath != "" && drv.queryDrvPath () == "";
+}
+
+// evaluate a single attribute path of the channels
+static DrvInfo
+nix_eval_attr_path (EvalState & state, Value & root, const string & attrPath)
+{
+	Bindings & bindings (*state.allocBindings (0));
+	Value & v (*findAlongAttrPath (state, attrPath, bindings, root));
+
+	DrvInfos drvs;
+	getDerivations (state, v, "", bindings, drvs, true);
+	if (drvs.size () != 1)
+		throw Error (format ("attribute '%1%' did not evaluate to a single derivation") % attrPath);
+
+	DrvInfo & drv = drvs.front ();
+	drv.attrPath = attrPath;
+	return drv;
+}
+
+// evaluate a drv loaded from the index, which only has the fields needed
+// for listing, searching and filtering; other drvs are returned as is
+DrvInfo
+nix_eval_drv (EvalState & state, const Path & homedir, DrvInfo & drv)
+{
+	if (!nix_drv_is_indexed (drv))
+		return drv;
+
+	Value root;
+	loadSourceExpr (state, homedir + "/.nix-defexpr", root);
+	return nix_eval_attr_path (state, root, drv.attrPath);
+}
+
+// get all drvs from list of ids, evaluating the ones from the index
 DrvInfos
-nix_get_drvs_from_ids (EvalState & state, DrvInfos drvs, gchar** package_ids)
+nix_get_drvs_from_ids (EvalState & state, const Path & homedir, NixDrvMaps & maps, gchar** package_ids)
 {
 	DrvInfos _drvs;
+	Value root;
+	bool loaded = false;
 
 	for (; *package_ids != NULL; package_ids++)
-		_drvs.push_back (
-			nix_find_drv (
-				state,
-				drvs,
-				*package_ids
-			)
-		);
+	{
+		DrvInfo drv = nix_find_drv (state, maps, *package_ids);
+		if (!nix_drv_is_indexed (drv))
+		{
+			_drvs.push_back (drv);
+			continue;
+		}
+
+		// only load the channels once, and only if needed
+		if (!loaded)
+		{
+			loadSourceExpr (state, homedir + "/.nix-defexpr", root);
+			loaded = true;
+		}
+		_drvs.push_back (nix_eval_attr_path (state, root, drv.attrPath));
+	}
 
 	return _drvs;
 }
@@ -140,19 +287,206 @@ nix_get_state ()
 	return new EvalState (searchPath, store);
 }
 
-// get all derivations
-// TODO: figure out how to speed this up
+// the channel generations that ~/.nix-defexpr currently points to,
+// which only change when a channel is updated
+static string
+nix_get_defexpr_key (const Path & homedir)
+{
+	Path defexpr = homedir + "/.nix-defexpr";
+	string key;
+	struct stat st;
+
+	if (stat (defexpr.c_str (), &st) == 0 && S_ISDIR (st.st_mode))
+	{
+		DirEntries entries = readDirectory (defexpr);
+		std::sort (entries.begin (), entries.end (),
+			   [] (const DirEntry & a, const DirEntry & b) { return a.name < b.name; });
+		for (auto & entry : entries)
+			key += entry.name + "=" + canonPath (defexpr + "/" + entry.name, true) + "\n";
+	}
+	else
+		key = canonPath (defexpr, true);
+
+	g_autofree gchar* checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA256, key.c_str (), -1);
+	return checksum;
+}
+
+// load the derivations written by nix_save_derivations_index
+static bool
+nix_load_derivations_index (EvalState & state, const string & key, DrvInfos & drvs)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GMappedFile) mapped = g_mapped_file_new (NIX_DRV_INDEX_FILENAME, FALSE, &error);
+	if (mapped == NULL)
+	{
+		g_debug ("no derivations index: %s", error->message);
+		return false;
+	}
+
+	const gchar* data = g_mapped_file_get_contents (mapped);
+	gsize len = g_mapped_file_get_length (mapped);
+
+	// the header is the format and the channel key
+	string header = string (NIX_DRV_INDEX_MAGIC "\n") + key + "\n";
+	if (len < header.size () || header.compare (0, header.size (), data, header.size ()) != 0)
+	{
+		g_debug ("derivations index is out of date");
+		return false;
+	}
+	if (len > header.size () && data[len - 1] != '\0')
+	{
+		g_warning ("derivations index is truncated");
+		return false;
+	}
+
+	DrvInfos _drvs;
+	const gchar* fields[NIX_DRV_INDEX_FIELDS];
+	const gchar* end = data + len;
+	guint n = 0;
+	for (const gchar* p = data + header.size (); p < end; p += strlen (p) + 1)
+	{
+		fields[n++] = p;
+		if (n < NIX_DRV_INDEX_FIELDS)
+			continue;
+		n = 0;
+
+		// attrPath, name, system, outPath, description, priority,
+		// platforms, failed
+		DrvInfo drv (state, fields[1], fields[0], fields[2], "", fields[3]);
+		if (fields[4][0] != '\0')
+		{
+			Value* v = state.allocValue ();
+			mkString (*v, fields[4]);
+			drv.setMeta ("description", v);
+		}
+		if (fields[5][0] != '\0')
+		{
+			Value* v = state.allocValue ();
+			mkInt (*v, g_ascii_strtoll (fields[5], NULL, 10));
+			drv.setMeta ("priority", v);
+		}
+		if (g_strcmp0 (fields[6], NIX_DRV_INDEX_NO_LIST) != 0)
+		{
+			g_auto(GStrv) systems = g_strsplit (fields[6], " ", -1);
+			guint size = fields[6][0] != '\0' ? g_strv_length (systems) : 0;
+			Value* v = state.allocValue ();
+			state.mkList (*v, size);
+			for (guint i = 0; i < size; i++)
+			{
+				v->listElems ()[i] = state.allocValue ();
+				mkString (*v->listElems ()[i], systems[i]);
+			}
+			drv.setMeta ("platforms", v);
+		}
+		if (fields[7][0] != '\0')
+			drv.setFailed ();
+		_drvs.push_back (drv);
+	}
+	if (n != 0)
+	{
+		g_warning ("derivations index is corrupt");
+		return false;
+	}
+
+	g_debug ("loaded %zu derivations from index", _drvs.size ());
+	drvs = _drvs;
+	return true;
+}
+
+// write the fields needed to list, search and filter drvs, and to pick
+// updates, without evaluating
+static void
+nix_save_derivations_index (DrvInfos & drvs, const string & key)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GString) data = g_string_new (NIX_DRV_INDEX_MAGIC "\n");
+	g_string_append (data, key.c_str ());
+	g_string_append_c (data, '\n');
+
+	for (auto & drv : drvs)
+	{
+		string outPath;
+		string description;
+		string priority;
+		string platforms = NIX_DRV_INDEX_NO_LIST;
+		string failed = drv.hasFailed () ? "1" : "";
+		try
+		{
+			outPath = drv.queryOutPath ();
+			description = drv.queryMetaString ("description");
+			if (drv.queryMeta ("priority") != NULL)
+				priority = std::to_string (drv.queryMetaInt ("priority", 0));
+
+			// the same strings that nix_filter_drv() looks at
+			auto meta = drv.queryMeta ("platforms");
+			if (meta != NULL && meta->isList ())
+			{
+				platforms = "";
+				for (auto i = meta->listElems (); i != meta->listElems () + meta->listSize (); i++)
+				{
+					if (*i == NULL || (*i)->type != tString)
+						continue;
+					if (platforms != "")
+						platforms += " ";
+					platforms += (*i)->string.s;
+				}
+			}
+		}
+		catch (Error & e)
+		{
+			continue;
+		}
+
+		const string* fields[NIX_DRV_INDEX_FIELDS] = {
+			&drv.attrPath,
+			&drv.name,
+			&drv.system,
+			&outPath,
+			&description,
+			&priority,
+			&platforms,
+			&failed
+		};
+		for (auto field : fields)
+			g_string_append_len (data, field->c_str (), field->size () + 1);
+	}
+
+	if (g_mkdir_with_parents (NIX_DRV_INDEX_DIR, 0755) < 0)
+	{
+		g_warning ("failed to create %s", NIX_DRV_INDEX_DIR);
+		return;
+	}
+	if (!g_file_set_contents (NIX_DRV_INDEX_FILENAME, data->str, data->len, &error))
+		g_warning ("failed to save derivations index: %s", error->message);
+}
+
+// get all derivations from the index, without evaluating anything
+bool
+nix_get_indexed_derivations (EvalState & state, const Path & homedir, DrvInfos & drvs)
+{
+	return nix_load_derivations_index (state, nix_get_defexpr_key (homedir), drvs);
+}
+
+// get all derivations, from the index if the channels have not changed
 DrvInfos
-nix_get_all_derivations (EvalState & state, const Path & homedir)
+nix_get_all_derivations (EvalState & state, const Path & homedir, bool force)
 {
+	DrvInfos drvs;
+	string key = nix_get_defexpr_key (homedir);
+
+	if (!force && nix_load_derivations_index (state, key, drvs))
+		return drvs;
+
+	// this is slow, but only happens once per channel generation
 	Value v;
 	loadSourceExpr (state, homedir + "/.nix-defexpr", v);
 
 	Bindings & bindings(*state.allocBindings(0));
 
-	DrvInfos drvs;
 	getDerivations (state, v, "", bindings, drvs, true);
 
+	nix_save_derivations_index (drvs, key);
+
 	return drvs;
 }
 
@@ -24,12 +24,21 @@
 
 #include <pwd.h>
 #include <glib.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <pk-backend.h>
 #include <pk-backend-job.h>
 
 #include "nix-lib-plus.hh"
 
+// lookup tables into a loaded set of drvs, only valid while it is
+typedef struct {
+	std::unordered_map<string, DrvInfo*> attrPaths;
+	std::unordered_map<string, std::vector<DrvInfo*>> names;
+} NixDrvMaps;
+
 void
 pk_nix_run (PkBackendJob *job, PkStatusEnum status, PkBackendJobThreadFunc func, gpointer data);
 
@@ -40,19 +49,37 @@ gboolean
 pk_nix_finish (PkBackendJob* job, GError* error);
 
 DrvInfos
-nix_get_drvs_from_ids (EvalState & state, DrvInfos drvs, gchar** package_ids);
+nix_get_drvs_from_ids (EvalState & state, const Path & homedir, NixDrvMaps & maps, gchar** package_ids);
+
+DrvInfo
+nix_eval_drv (EvalState & state, const Path & homedir, DrvInfo & drv);
 
 EvalState*
 nix_get_state ();
 
 DrvInfos
-nix_get_all_derivations (EvalState & state, const Path & path);
+nix_get_all_derivations (EvalState & state, const Path & path, bool force = false);
+
+bool
+nix_get_indexed_derivations (EvalState & state, const Path & path, DrvInfos & drvs);
 
 gchar*
 nix_drv_package_id (DrvInfo & drv);
 
 DrvInfo
-nix_find_drv (EvalState & state, DrvInfos drvs, gchar* package_id);
+nix_find_drv (EvalState & state, NixDrvMaps & maps, gchar* package_id);
+
+void
+nix_build_drv_maps (DrvInfos & drvs, NixDrvMaps & maps);
+
+std::unordered_set<string>
+nix_drv_names (DrvInfos & drvs);
+
+PkInfoEnum
+nix_drv_installed_info (const std::unordered_set<string> & installedNames, DrvInfo & drv, PkBitfield filters);
+
+DrvInfo*
+nix_find_update (EvalState & state, NixDrvMaps & maps, DrvInfo & installed, string & bestVersion);
 
 bool
 nix_filter_drv (EvalState & state, DrvInfo & drv, const Settings & settings, PkBitfield filters);
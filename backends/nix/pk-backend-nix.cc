@@ -33,6 +33,14 @@ typedef struct {
 static PkBackendNixPrivate* priv;
 static EvalState* state;
 static DrvInfos drvs;
+static NixDrvMaps drvMaps;
+
+static void
+pk_backend_nix_set_drvs (const DrvInfos & _drvs)
+{
+	drvs = _drvs;
+	nix_build_drv_maps (drvs, drvMaps);
+}
 
 void
 pk_backend_initialize (GKeyFile* conf, PkBackend* backend)
@@ -54,6 +62,11 @@ pk_backend_initialize (GKeyFile* conf, PkBackend* backend)
 		initGC();
 
 		state = nix_get_state();
+
+		// the first job evaluates the channels if this is out of date
+		DrvInfos _drvs;
+		if (nix_get_indexed_derivations (*state, priv->roothome, _drvs))
+			pk_backend_nix_set_drvs (_drvs);
 	}
 	catch (std::exception & e)
 	{
@@ -203,9 +216,9 @@ pk_backend_get_details_thread (PkBackendJob* job, GVariant* params, gpointer p)
 	{
 		// possibly slow call
 		if (drvs.empty ())
-			drvs = nix_get_all_derivations (*state, priv->roothome);
+			pk_backend_nix_set_drvs (nix_get_all_derivations (*state, priv->roothome));
 
-		DrvInfos _drvs = nix_get_drvs_from_ids (*state, drvs, (gchar**) p);
+		DrvInfos _drvs = nix_get_drvs_from_ids (*state, priv->roothome, drvMaps, (gchar**) p);
 
 		for (auto drv : _drvs)
 		{
@@ -244,6 +257,7 @@ pk_backend_get_details_thread (PkBackendJob* job, GVariant* params, gpointer p)
 	}
 	catch (std::exception & e)
 	{
+		g_set_error_literal (&error, G_IO_ERROR, G_IO_ERROR_FAILED, e.what ());
 	}
 
 	pk_nix_finish (job, error);
@@ -267,15 +281,16 @@ pk_backend_get_packages_thread (PkBackendJob* job, GVariant* params, gpointer p)
 	{
 		// possibly slow call
 		if (drvs.empty ())
-			drvs = nix_get_all_derivations (*state, priv->roothome);
+			pk_backend_nix_set_drvs (nix_get_all_derivations (*state, priv->roothome));
 
 		auto profile = nix_get_profile (job);
 		DrvInfos installedDrvs = queryInstalled (*state, profile);
+		auto installedNames = nix_drv_names (installedDrvs);
 
 		int n = 0;
 		double percentFactor = 100 / drvs.size ();
 
-		for (auto drv : drvs)
+		for (auto & drv : drvs)
 		{
 			if (pk_backend_job_is_cancelled (job))
 				break;
@@ -285,19 +300,8 @@ pk_backend_get_packages_thread (PkBackendJob* job, GVariant* params, gpointer p)
 			if (!nix_filter_drv (*state, drv, settings, filters))
 				continue;
 
-			auto info = PK_INFO_ENUM_AVAILABLE;
-
-			for (auto _drv : installedDrvs)
-				if (_drv.name == drv.name)
-				{
-					info = PK_INFO_ENUM_INSTALLED;
-					break;
-				}
-
-			if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED) && info != PK_INFO_ENUM_INSTALLED)
-				continue;
-
-			if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED) && info == PK_INFO_ENUM_INSTALLED)
+			auto info = nix_drv_installed_info (installedNames, drv, filters);
+			if (info == PK_INFO_ENUM_UNKNOWN)
 				continue;
 
 			pk_backend_job_package (
@@ -334,10 +338,11 @@ pk_backend_resolve_thread (PkBackendJob* job, GVariant* params, gpointer p)
 	{
 		// possibly slow call
 		if (drvs.empty ())
-			drvs = nix_get_all_derivations (*state, priv->roothome);
+			pk_backend_nix_set_drvs (nix_get_all_derivations (*state, priv->roothome));
 
 		auto profile = nix_get_profile (job);
 		DrvInfos installedDrvs = queryInstalled (*state, profile);
+		auto installedNames = nix_drv_names (installedDrvs);
 
 		for (; *search != NULL; ++search)
 		{
@@ -346,27 +351,25 @@ pk_backend_resolve_thread (PkBackendJob* job, GVariant* params, gpointer p)
 
 			DrvName searchName (*search);
 
-			for (auto drv : drvs)
+			// only a wildcard has to look at every drv
+			std::vector<DrvInfo*> candidates;
+			if (searchName.name == "*")
+				for (auto & drv : drvs)
+					candidates.push_back (&drv);
+			else if (drvMaps.names.count (searchName.name))
+				candidates = drvMaps.names[searchName.name];
+
+			for (auto candidate : candidates)
 			{
+				auto & drv = *candidate;
 				DrvName drvName (drv.name);
 				if (searchName.matches (drvName))
 				{
 					if (!nix_filter_drv (*state, drv, settings, filters))
 						continue;
 
-					auto info = PK_INFO_ENUM_AVAILABLE;
-
-					for (auto _drv : installedDrvs)
-						if (_drv.name == drv.name)
-						{
-							info = PK_INFO_ENUM_INSTALLED;
-							break;
-						}
-
-					if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED) && info != PK_INFO_ENUM_INSTALLED)
-						continue;
-
-					if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED) && info == PK_INFO_ENUM_INSTALLED)
+					auto info = nix_drv_installed_info (installedNames, drv, filters);
+					if (info == PK_INFO_ENUM_UNKNOWN)
 						continue;
 
 					pk_backend_job_package (
@@ -405,35 +408,25 @@ pk_backend_search_names_thread (PkBackendJob* job, GVariant* params, gpointer p)
 	{
 		// possibly slow call
 		if (drvs.empty ())
-			drvs = nix_get_all_derivations (*state, priv->roothome);
+			pk_backend_nix_set_drvs (nix_get_all_derivations (*state, priv->roothome));
 
 		auto profile = nix_get_profile (job);
 		DrvInfos installedDrvs = queryInstalled (*state, profile);
+		auto installedNames = nix_drv_names (installedDrvs);
 
 		for (; *search != NULL; ++search)
 		{
 			if (pk_backend_job_is_cancelled (job))
 				break;
 
-			for (auto drv : drvs)
+			for (auto & drv : drvs)
 				if (drv.name.find(*search) != -1)
 				{
 					if (!nix_filter_drv (*state, drv, settings, filters))
 						continue;
 
-					auto info = PK_INFO_ENUM_AVAILABLE;
-
-					for (auto _drv : installedDrvs)
-						if (_drv.name == drv.name)
-						{
-							info = PK_INFO_ENUM_INSTALLED;
-							break;
-						}
-
-					if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED) && info != PK_INFO_ENUM_INSTALLED)
-						continue;
-
-					if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED) && info == PK_INFO_ENUM_INSTALLED)
+					auto info = nix_drv_installed_info (installedNames, drv, filters);
+					if (info == PK_INFO_ENUM_UNKNOWN)
 						continue;
 
 					pk_backend_job_package (
@@ -471,35 +464,25 @@ pk_backend_search_details_thread (PkBackendJob* job, GVariant* params, gpointer
 	{
 		// possibly slow call
 		if (drvs.empty ())
-			drvs = nix_get_all_derivations (*state, priv->roothome);
+			pk_backend_nix_set_drvs (nix_get_all_derivations (*state, priv->roothome));
 
 		auto profile = nix_get_profile (job);
 		DrvInfos installedDrvs = queryInstalled (*state, profile);
+		auto installedNames = nix_drv_names (installedDrvs);
 
 		for (; *value != NULL; ++value)
 		{
 			if (pk_backend_job_is_cancelled (job))
 				break;
 
-			for (auto drv : drvs)
+			for (auto & drv : drvs)
 				if (drv.queryMetaString ("description").find (*value) != -1)
 				{
 					if (!nix_filter_drv (*state, drv, settings, filters))
 						continue;
 
-					auto info = PK_INFO_ENUM_AVAILABLE;
-
-					for (auto _drv : installedDrvs)
-						if (_drv.name == drv.name)
-						{
-							info = PK_INFO_ENUM_INSTALLED;
-							break;
-						}
-
-					if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED) && info != PK_INFO_ENUM_INSTALLED)
-						continue;
-
-					if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED) && info == PK_INFO_ENUM_INSTALLED)
+					auto info = nix_drv_installed_info (installedNames, drv, filters);
+					if (info == PK_INFO_ENUM_UNKNOWN)
 						continue;
 
 					pk_backend_job_package (
@@ -528,11 +511,15 @@ static void
 pk_backend_refresh_cache_thread (PkBackendJob* job, GVariant* params, gpointer p)
 {
 	g_autoptr (GError) error = NULL;
+	gboolean force;
+
+	g_variant_get (params, "(b)", &force);
 
 	try
 	{
+		// only evaluates again if a channel was updated
 		state = nix_get_state ();
-		drvs = nix_get_all_derivations (*state, priv->roothome);
+		pk_backend_nix_set_drvs (nix_get_all_derivations (*state, priv->roothome, force));
 	}
 	catch (std::exception & e)
 	{
@@ -561,9 +548,9 @@ pk_backend_install_packages_thread (PkBackendJob* job, GVariant* params, gpointe
 	{
 		// possibly slow call
 		if (drvs.empty ())
-			drvs = nix_get_all_derivations (*state, priv->roothome);
+			pk_backend_nix_set_drvs (nix_get_all_derivations (*state, priv->roothome));
 
-		DrvInfos newElems = nix_get_drvs_from_ids (*state, drvs, package_ids);
+		DrvInfos newElems = nix_get_drvs_from_ids (*state, priv->roothome, drvMaps, package_ids);
 
 		for (auto drv : newElems)
 		{
@@ -609,6 +596,7 @@ pk_backend_install_packages_thread (PkBackendJob* job, GVariant* params, gpointe
 	}
 	catch (std::exception & e)
 	{
+		g_set_error_literal (&error, G_IO_ERROR, G_IO_ERROR_FAILED, e.what ());
 	}
 
 	pk_nix_finish (job, error);
@@ -634,9 +622,9 @@ pk_backend_remove_packages_thread (PkBackendJob* job, GVariant* params, gpointer
 	{
 		// possibly slow call
 		if (drvs.empty ())
-			drvs = nix_get_all_derivations(*state, priv->roothome);
+			pk_backend_nix_set_drvs (nix_get_all_derivations(*state, priv->roothome));
 
-		DrvInfos _drvs = nix_get_drvs_from_ids (*state, drvs, package_ids);
+		DrvInfos _drvs = nix_get_drvs_from_ids (*state, priv->roothome, drvMaps, package_ids);
 
 		for (auto drv : _drvs)
 		{
@@ -660,20 +648,13 @@ pk_backend_remove_packages_thread (PkBackendJob* job, GVariant* params, gpointer
 			DrvInfos installedElems = queryInstalled (*state, profile);
 			DrvInfos newElems;
 
-			for (auto & drv : installedElems)
-			{
-				bool found = false;
-
-				for (auto & _drv : _drvs)
-					if (drv.attrPath == _drv.attrPath)
-					{
-						found = true;
-						break;
-					}
+			std::unordered_set<string> removeAttrPaths;
+			for (auto & _drv : _drvs)
+				removeAttrPaths.insert (_drv.attrPath);
 
-				if (!found)
+			for (auto & drv : installedElems)
+				if (!removeAttrPaths.count (drv.attrPath))
 					newElems.push_back (drv);
-			}
 
 			if (createUserEnv (*state, newElems, profile, false, lockToken))
 				break;
@@ -691,6 +672,7 @@ pk_backend_remove_packages_thread (PkBackendJob* job, GVariant* params, gpointer
 	}
 	catch (std::exception & e)
 	{
+		g_set_error_literal (&error, G_IO_ERROR, G_IO_ERROR_FAILED, e.what ());
 	}
 
 	pk_nix_finish (job, error);
@@ -711,7 +693,7 @@ pk_backend_update_packages_thread (PkBackendJob* job, GVariant* params, gpointer
 	{
 		// possibly slow call
 		if (drvs.empty ())
-			drvs = nix_get_all_derivations (*state, priv->roothome);
+			pk_backend_nix_set_drvs (nix_get_all_derivations (*state, priv->roothome));
 
 		auto profile = nix_get_profile (job);
 
@@ -745,37 +727,10 @@ pk_backend_update_packages_thread (PkBackendJob* job, GVariant* params, gpointer
 					   priority.  If there are still multiple matches,
 					   take the one with the highest version.
 					   Do not upgrade if it would decrease the priority. */
-					DrvInfos::iterator bestElem = drvs.end ();
 					string bestVersion;
+					DrvInfo* bestElem = nix_find_update (*state, drvMaps, i, bestVersion);
 
-					for (auto j = drvs.begin (); j != drvs.end (); ++j)
-					{
-						if (comparePriorities (*state, i, *j) > 0)
-							continue;
-
-						DrvName newName (j->name);
-						if (newName.name == drvName.name)
-						{
-							int d = compareVersions (drvName.version, newName.version);
-							if (d < 0)
-							{
-								int d2 = -1;
-								if (bestElem != drvs.end ())
-								{
-									d2 = comparePriorities (*state, *bestElem, *j);
-									if (d2 == 0)
-										d2 = compareVersions (bestVersion, newName.version);
-								}
-								if (d2 < 0)
-								{
-									bestElem = j;
-									bestVersion = newName.version;
-								}
-							}
-						}
-					}
-
-					if (bestElem != drvs.end () && i.queryOutPath () != bestElem->queryOutPath ())
+					if (bestElem != NULL && i.queryOutPath () != bestElem->queryOutPath ())
 					{
 						const char * action;
 						auto _drv = *bestElem;
@@ -801,7 +756,7 @@ pk_backend_update_packages_thread (PkBackendJob* job, GVariant* params, gpointer
 
 							action = "downgrading";
 						}
-						newElems.push_back (*bestElem);
+						newElems.push_back (nix_eval_drv (*state, priv->roothome, _drv));
 					}
 					else
 						newElems.push_back (i);
@@ -830,6 +785,7 @@ pk_backend_update_packages_thread (PkBackendJob* job, GVariant* params, gpointer
 	}
 	catch (std::exception & e)
 	{
+		g_set_error_literal (&error, G_IO_ERROR, G_IO_ERROR_FAILED, e.what ());
 	}
 
 	pk_nix_finish (job, error);
@@ -854,9 +810,9 @@ pk_backend_download_packages_thread (PkBackendJob* job, GVariant* params, gpoint
 	{
 		// possibly slow call
 		if (drvs.empty ())
-			drvs = nix_get_all_derivations (*state, priv->roothome);
+			pk_backend_nix_set_drvs (nix_get_all_derivations (*state, priv->roothome));
 
-		DrvInfos _drvs = nix_get_drvs_from_ids (*state, drvs, package_ids);
+		DrvInfos _drvs = nix_get_drvs_from_ids (*state, priv->roothome, drvMaps, package_ids);
 
 		PathSet paths;
 		for (auto drv : _drvs)
@@ -880,6 +836,7 @@ pk_backend_download_packages_thread (PkBackendJob* job, GVariant* params, gpoint
 	}
 	catch (std::exception & e)
 	{
+		g_set_error_literal (&error, G_IO_ERROR, G_IO_ERROR_FAILED, e.what ());
 	}
 
 	pk_nix_finish (job, error);
@@ -0,0 +1,70 @@
+/* -*- Mode: C; tab-width: 8; indent-tab-modes: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The PackageKit Authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// stubs for the job functions that nix-helpers.cc links against
+#include <pk-backend.h>
+#include <pk-backend-job.h>
+
+guint
+pk_backend_job_get_uid (PkBackendJob *job)
+{
+	return 0;
+}
+
+void
+pk_backend_job_set_status (PkBackendJob *job, PkStatusEnum status)
+{
+}
+
+void
+pk_backend_job_set_percentage (PkBackendJob *job, guint percentage)
+{
+}
+
+void
+pk_backend_job_set_allow_cancel (PkBackendJob *job, gboolean allow_cancel)
+{
+}
+
+void
+pk_backend_job_set_started (PkBackendJob *job, gboolean started)
+{
+}
+
+gboolean
+pk_backend_job_thread_create (PkBackendJob *job,
+			      PkBackendJobThreadFunc func,
+			      gpointer user_data,
+			      GDestroyNotify destroy_func)
+{
+	return FALSE;
+}
+
+void
+pk_backend_job_error_code (PkBackendJob *job,
+		PkErrorEnum error_code, const gchar *format, ...)
+{
+}
+
+void
+pk_backend_job_finished (PkBackendJob *job)
+{
+}
@@ -0,0 +1,159 @@
+/* -*- Mode: C; tab-width: 8; indent-tab-modes: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The PackageKit Authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "nix-helpers.hh"
+
+#define NIX_BENCH_DRVS		100000
+#define NIX_BENCH_INSTALLED	1000
+#define NIX_BENCH_LOOKUPS	1000
+
+static EvalState* state;
+static DrvInfos drvs;
+
+// a synthetic drv set, roughly the shape of nixpkgs
+static void
+nix_bench_make_drvs ()
+{
+	for (guint i = 0; i < NIX_BENCH_DRVS; i++)
+	{
+		g_autofree gchar* name = g_strdup_printf ("pkg%u-1.%u", i / 2, i % 2);
+		g_autofree gchar* attrPath = g_strdup_printf ("pkgs.pkg%u", i);
+		DrvInfo drv (*state, name, attrPath, "x86_64-linux", "", "");
+		drvs.push_back (drv);
+	}
+}
+
+static void
+test_nix_find_drv ()
+{
+	NixDrvMaps maps;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	nix_build_drv_maps (drvs, maps);
+	g_test_message ("indexing %u drvs: %.1fms",
+			NIX_BENCH_DRVS, g_timer_elapsed (timer, NULL) * 1000);
+	g_assert_cmpint (maps.attrPaths.size (), ==, NIX_BENCH_DRVS);
+	g_assert_cmpint (maps.names.size (), ==, NIX_BENCH_DRVS / 2);
+
+	// spread the lookups over the whole set
+	g_timer_reset (timer);
+	for (guint i = 0; i < NIX_BENCH_LOOKUPS; i++)
+	{
+		guint n = i * (NIX_BENCH_DRVS / NIX_BENCH_LOOKUPS);
+		g_autofree gchar* attrPath = g_strdup_printf ("pkgs.pkg%u", n);
+		g_autofree gchar* package_id = pk_package_id_build ("pkg", "1", "x86_64-linux", attrPath);
+		DrvInfo drv = nix_find_drv (*state, maps, package_id);
+		g_assert_cmpstr (drv.attrPath.c_str (), ==, attrPath);
+	}
+	g_test_message ("%u lookups by attrpath: %.1fms",
+			NIX_BENCH_LOOKUPS, g_timer_elapsed (timer, NULL) * 1000);
+
+	// the same lookups done the old way, for comparison
+	g_timer_reset (timer);
+	for (guint i = 0; i < NIX_BENCH_LOOKUPS; i++)
+	{
+		guint n = i * (NIX_BENCH_DRVS / NIX_BENCH_LOOKUPS);
+		g_autofree gchar* attrPath = g_strdup_printf ("pkgs.pkg%u", n);
+		for (auto & drv : drvs)
+			if (drv.attrPath == attrPath)
+				break;
+	}
+	g_test_message ("%u linear lookups by attrpath: %.1fms",
+			NIX_BENCH_LOOKUPS, g_timer_elapsed (timer, NULL) * 1000);
+
+	// a missing attrpath or the wrong system finds nothing
+	DrvInfo drv = nix_find_drv (*state, maps, (gchar*) "pkg;1;x86_64-linux;pkgs.missing");
+	g_assert_cmpstr (drv.attrPath.c_str (), ==, "");
+	drv = nix_find_drv (*state, maps, (gchar*) "pkg;1;i686-linux;pkgs.pkg0");
+	g_assert_cmpstr (drv.attrPath.c_str (), ==, "");
+}
+
+static void
+test_nix_drv_names ()
+{
+	NixDrvMaps maps;
+	DrvInfos installedDrvs;
+	g_autoptr(GTimer) timer = g_timer_new ();
+	guint installed = 0;
+	guint updates = 0;
+	PkBitfield filters = pk_bitfield_value (PK_FILTER_ENUM_INSTALLED);
+
+	nix_build_drv_maps (drvs, maps);
+
+	// the older version of every n-th pair is installed
+	for (guint i = 0; i < NIX_BENCH_INSTALLED; i++)
+	{
+		guint n = i * (NIX_BENCH_DRVS / NIX_BENCH_INSTALLED);
+		g_autofree gchar* name = g_strdup_printf ("pkg%u-1.0", n / 2);
+		DrvInfo drv (*state, name, "", "x86_64-linux", "", "");
+		installedDrvs.push_back (drv);
+	}
+
+	// what GetPackages does for every drv
+	g_timer_reset (timer);
+	auto installedNames = nix_drv_names (installedDrvs);
+	for (auto & drv : drvs)
+		if (nix_drv_installed_info (installedNames, drv, filters) == PK_INFO_ENUM_INSTALLED)
+			installed++;
+	g_test_message ("checking %u drvs against %u installed: %.1fms",
+			NIX_BENCH_DRVS, NIX_BENCH_INSTALLED, g_timer_elapsed (timer, NULL) * 1000);
+	g_assert_cmpint (installed, ==, NIX_BENCH_INSTALLED);
+
+	// every installed drv has a newer version with the same name
+	g_timer_reset (timer);
+	for (auto & i : installedDrvs)
+	{
+		string bestVersion;
+		DrvInfo* update = nix_find_update (*state, maps, i, bestVersion);
+		g_assert (update != NULL);
+		g_assert_cmpstr (bestVersion.c_str (), ==, "1.1");
+		updates++;
+	}
+	g_test_message ("finding updates for %u installed: %.1fms",
+			NIX_BENCH_INSTALLED, g_timer_elapsed (timer, NULL) * 1000);
+	g_assert_cmpint (updates, ==, NIX_BENCH_INSTALLED);
+}
+
+int
+main (int argc, char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	initNix ();
+	initGC ();
+
+	// the evaluator needs a store, which the build host may not have
+	try
+	{
+		state = nix_get_state ();
+	}
+	catch (std::exception & e)
+	{
+		g_print ("skipping, no nix store: %s\n", e.what ());
+		return 77;
+	}
+	nix_bench_make_drvs ();
+
+	g_test_add_func ("/nix/find_drv", test_nix_find_drv);
+	g_test_add_func ("/nix/drv_names", test_nix_drv_names);
+
+	return g_test_run ();
+}
@@ -174,9 +174,33 @@ GROUPS = {
     _resolve(filters, packages)
   end
 
+  # one pass over the INDEX, kept until the INDEX itself changes
+  def _port_index
+    mtime = File.mtime($portsdb.index_file) rescue nil
+    if @port_index.nil? or @port_index_mtime != mtime
+      @port_index = Hash.new
+      $portsdb.each do |portinfo|
+        port = PortInfo.new(portinfo)
+        pkg = PkgInfo.new(port.pkgname)
+        [port.origin, pkg.name, pkg.fullname].uniq.each do |key|
+          (@port_index[key] ||= []) << port
+        end
+      end
+      @port_index_mtime = mtime
+    end
+    return @port_index
+  end
+
+  # looks up ports by origin, name or name-version without rescanning the INDEX
+  def _ports(pattern)
+    pattern = pattern.to_s
+    return $portsdb.glob(pattern) if pattern =~ /[*?\[]/
+    return _port_index[pattern] || []
+  end
+
   def _resolve(filters, packages)
     packages.each do |package|
-      portnames = $portsdb.glob(package)
+      portnames = _ports(package)
       if portnames
       portnames.each do |port|
         pkg = PkgInfo.new(port.pkgname)
@@ -335,7 +359,7 @@ GROUPS = {
     package_ids.each do |package|
       name, version, arch, data = split_package_id(package)
 
-      pkgnames = $portsdb.glob(name)
+      pkgnames = _ports(name)
       if pkgnames
        pkgnames.each do |port|
         pkg = PkgInfo.new(port.pkgname)
@@ -379,7 +403,7 @@ GROUPS = {
     package_ids.each do |package|
       name, version, arch, data = split_package_id(package)
 
-      pkgnames = $portsdb.glob(name)
+      pkgnames = _ports(name)
       if pkgnames
         pkgnames.each do |port|
         pkg = PkgInfo.new(port.pkgname)
@@ -414,7 +438,7 @@ GROUPS = {
     package_ids.each do |package|
       name, version, arch, data = split_package_id(package)
 
-      pkgnames = $portsdb.glob(name)
+      pkgnames = _ports(name)
       if pkgnames
         pkgnames.each do |port|
         pkg = PkgInfo.new(port.pkgname)
@@ -436,7 +460,7 @@ GROUPS = {
     package_ids.each do |package|
       name, version, arch, data = split_package_id(package)
 
-     pkgnames = $portsdb.glob(name)
+     pkgnames = _ports(name)
       if pkgnames
        pkgnames.each do |port|
         pkg = PkgInfo.new(port.pkgname)
@@ -565,7 +589,7 @@ VULN_XML = 'vuln.xml'
     package_ids.each do |package|
       name, version, arch, data = split_package_id(package)
 
-     pkgnames = $portsdb.glob(name)
+     pkgnames = _ports(name)
       if pkgnames
        pkgnames.each do |port|
         pkg = PkgInfo.new(port.pkgname)
@@ -582,7 +606,7 @@ VULN_XML = 'vuln.xml'
           data = oldpkg.installed? ? 'installed' : 'ports'
           updates = get_package_id(oldpkg.name, oldpkg.version, $pkg_arch, data)
         else
-          pkgnames = $portsdb.glob(name)
+          pkgnames = _ports(name)
           pkgnames.each do |oldport|
             oldpkg = PkgInfo.new(oldport.pkgname)
             next if oldpkg.version != version
@@ -676,7 +700,7 @@ BIN_PKG = true
     pkgnames = []
     package_ids.each do |package|
       name, version, arch, data = split_package_id(package)
-      if not $portsdb.glob(name)
+      if not _ports(name)
         error(ERROR_PACKAGE_NOT_FOUND, "Package #{name} was not found", exit=false)
         next
       end
@@ -736,7 +760,7 @@ BIN_PKG = true
             pkgname = pkg.fullname
             if pkg.installed?
               error(ERROR_PACKAGE_ALREADY_INSTALLED, "The package #{pkgname} is already installed")
-            elsif $portsdb.glob(pkgname).empty?
+            elsif _ports(pkgname).empty?
               # portinstall is a little picky about installing packages for mismatched ports
               error(ERROR_PACKAGE_NOT_FOUND, "Port for #{pkgname} was not found", exit=true)
             else
@@ -763,7 +787,7 @@ BIN_PKG = true
     pkgnames = []
     package_ids.each do |package|
         name, version, arch, data = split_package_id(package)
-        if $portsdb.glob(name)
+        if _ports(name)
             pkgname = "#{name}-#{version}"
             pkg = PkgInfo.new(pkgname)
             if pkg.installed?
@@ -788,7 +812,7 @@ BIN_PKG = true
     pkgnames = []
     package_ids.each do |package|
         name, version, arch, data = split_package_id(package)
-        if $portsdb.glob(name)
+        if _ports(name)
             pkgname = "#{name}-#{version}"
             pkg = PkgInfo.new(pkgname)
             pkgnames << pkg.fullname
@@ -855,7 +879,7 @@ BIN_PKG = true
     pkgnames = []
     package_ids.each do |package|
       name, version, arch, data = split_package_id(package)
-      if not $portsdb.glob(name)
+      if not _ports(name)
         error(ERROR_PACKAGE_NOT_FOUND, "Package #{name} was not found", exit=false)
         next
       end
@@ -901,7 +925,7 @@ BIN_PKG = true
     end
   end
 
-  protected :_resolve, :_match_range, :_vuxml, :_install, :_upgrade, :_execute
+  protected :_port_index, :_ports, :_resolve, :_match_range, :_vuxml, :_install, :_upgrade, :_execute
 end
 
 #######################################################################
@@ -20,13 +20,20 @@ filter_package (PkBitfield filters, bool is_installed)
 	return false;
 }
 
-static std::string
-generate_query(PkBitfield filters)
+/**
+ * Builds the search query for the given column. The search term is bound as
+ * the first parameter, so there is only one query text for each column and
+ * filter combination and the statement can be cached on the connection.
+ */
+std::string
+generate_query (const gchar *column, PkBitfield filters)
 {
 	std::string query(
 			"SELECT (p1.name || ';' || p1.ver || ';' || p1.arch || ';' || r.repo), p1.summary, "
-			"p1.full_name FROM pkglist AS p1 NATURAL JOIN repos AS r "
-			"WHERE p1.%s LIKE '%%%q%%' AND p1.ext NOT LIKE 'obsolete' AND p1.repo_order = "
+			"p1.full_name FROM pkglist AS p1 NATURAL JOIN repos AS r WHERE p1.");
+	query.append(column);
+	query.append(
+			" LIKE '%' || ?1 || '%' AND p1.ext NOT LIKE 'obsolete' AND p1.repo_order = "
 			"(SELECT MIN(p2.repo_order) FROM pkglist AS p2 WHERE p2.name = p1.name GROUP BY p2.name)");
 
 	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_APPLICATION))
@@ -35,7 +42,7 @@ generate_query(PkBitfield filters)
 				" AND EXISTS (SELECT filelist.full_name "
 				"FROM filelist "
 				"WHERE filelist.full_name = p1.full_name "
-				"AND filelist.filename LIKE 'usr/share/applications/%%.desktop')");
+				"AND filelist.filename LIKE 'usr/share/applications/%.desktop')");
 	}
 	else if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_APPLICATION))
 	{
@@ -43,11 +50,39 @@ generate_query(PkBitfield filters)
 				" AND NOT EXISTS (SELECT filelist.full_name "
 				"FROM filelist "
 				"WHERE filelist.full_name = p1.full_name "
-				"AND filelist.filename LIKE 'usr/share/applications/%%.desktop')");
+				"AND filelist.filename LIKE 'usr/share/applications/%.desktop')");
 	}
 	return query;
 }
 
+/**
+ * Joins the installed packages to the package with the same name from the
+ * repository with the lowest order. SQLite takes the other columns from the
+ * row MIN() picks, and the primary key index on (name, repo_order) of pkglist
+ * serves the join, so pkglist isn't scanned once per installed package.
+ */
+const gchar *const updates_query =
+	"SELECT i.full_name, i.name, i.ver, i.arch, "
+	"p.full_name, p.name, p.ver, p.arch, r.repo, p.summary, p.ext, MIN(p.repo_order) "
+	"FROM temp.installed AS i "
+	"JOIN pkglist AS p ON p.name = i.name "
+	"JOIN repos AS r ON r.repo_order = p.repo_order "
+	"GROUP BY i.full_name";
+
+/**
+ * Creates the temporary table with the installed packages updates_query
+ * reads, or empties it if the connection already has one.
+ */
+bool
+installed_table_reset (sqlite3 *db)
+{
+	return sqlite3_exec (db,
+			"CREATE TEMP TABLE IF NOT EXISTS installed (full_name VARCHAR NOT NULL, "
+			"name VARCHAR NOT NULL, ver VARCHAR NOT NULL, arch VARCHAR NOT NULL);"
+			"DELETE FROM temp.installed",
+			NULL, NULL, NULL) == SQLITE_OK;
+}
+
 }
 
 void
@@ -63,12 +98,12 @@ pk_backend_search_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 	g_variant_get (params, "(t^a&s)", &filters, &vals);
 	gchar *search = g_strjoinv ("%", vals);
 
-	gchar *query = sqlite3_mprintf (slack::generate_query(filters).c_str(),
-			user_data, search);
-
-	sqlite3_stmt *stmt;
-	if ((sqlite3_prepare_v2 (job_data->db, query, -1, &stmt, NULL) == SQLITE_OK))
+	sqlite3_stmt *stmt = slack::connection_prepare (job_data->connection,
+			slack::generate_query (static_cast<const gchar *> (user_data), filters));
+	if (stmt)
 	{
+		sqlite3_bind_text (stmt, 1, search, -1, SQLITE_TRANSIENT);
+
 		/* Now we're ready to output all packages */
 		while (sqlite3_step (stmt) == SQLITE_ROW)
 		{
@@ -89,7 +124,7 @@ pk_backend_search_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 						reinterpret_cast<const gchar *> (sqlite3_column_text (stmt, 1)));
 			}
 		}
-		sqlite3_finalize (stmt);
+		slack::statement_reset (stmt);
 	}
 	else
 	{
@@ -97,7 +132,6 @@ pk_backend_search_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 				"%s", sqlite3_errmsg (job_data->db));
 	}
 
-	sqlite3_free (query);
 	g_free (search);
 
 	pk_backend_job_set_percentage (job, 100);
@@ -3,11 +3,18 @@
 
 #include <pk-backend.h>
 #include <sqlite3.h>
+#include <string>
 
 namespace slack {
 
 bool filter_package (PkBitfield filters, bool is_installed);
 
+std::string generate_query (const gchar *column, PkBitfield filters);
+
+extern const gchar *const updates_query;
+
+bool installed_table_reset (sqlite3 *db);
+
 }
 
 extern "C" {
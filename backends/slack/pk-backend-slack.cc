@@ -134,6 +134,7 @@ pk_backend_destroy(PkBackend *backend)
 	}
 
 	g_slist_free (repos);
+	connection_pool_free ();
 	curl_global_cleanup ();
 }
 
@@ -194,23 +195,20 @@ void
 pk_backend_start_job(PkBackend *backend, PkBackendJob *job)
 {
 	gchar *db_filename = NULL;
+	GError *err = NULL;
 	JobData *job_data = g_new0(JobData, 1);
 
 	pk_backend_job_set_allow_cancel(job, TRUE);
 	pk_backend_job_set_allow_cancel(job, FALSE);
 
 	db_filename = g_build_filename(LOCALSTATEDIR, "cache", "PackageKit", "metadata", "metadata.db", NULL);
-	if (sqlite3_open(db_filename, &job_data->db) == SQLITE_OK) { /* Some SQLite settings */
-		sqlite3_exec(job_data->db, "PRAGMA foreign_keys = ON", NULL, NULL, NULL);
-	}
-	else
+	if (!(job_data->connection = connection_acquire(db_filename, &err)))
 	{
-		pk_backend_job_error_code(job, PK_ERROR_ENUM_NO_CACHE,
-								  "%s: %s",
-								  db_filename,
-								  sqlite3_errmsg(job_data->db));
+		pk_backend_job_error_code(job, PK_ERROR_ENUM_NO_CACHE, "%s", err->message);
+		g_error_free(err);
 		goto out;
 	}
+	job_data->db = job_data->connection->db;
 
 	pk_backend_job_set_user_data(job, job_data);
 	pk_backend_job_set_status(job, PK_STATUS_ENUM_RUNNING);
@@ -229,7 +227,10 @@ pk_backend_stop_job(PkBackend *backend, PkBackendJob *job)
 		curl_easy_cleanup(job_data->curl);
 	}
 
-	sqlite3_close(job_data->db);
+	if (job_data->connection)
+	{
+		connection_release(job_data->connection);
+	}
 	g_free(job_data);
 	pk_backend_job_set_user_data(job, NULL);
 }
@@ -325,12 +326,9 @@ pk_backend_get_details_thread(PkBackendJob *job, GVariant *params, gpointer user
 
 	g_variant_get(params, "(^a&s)", &pkg_ids);
 
-	if ((sqlite3_prepare_v2(job_data->db,
+	if (!(stmt = connection_prepare(job_data->connection,
 							"SELECT p.desc, p.cat, p.uncompressed FROM pkglist AS p NATURAL JOIN repos AS r "
-							"WHERE name LIKE @name AND r.repo LIKE @repo AND ext NOT LIKE 'obsolete'",
-							-1,
-							&stmt,
-							NULL) != SQLITE_OK)) {
+							"WHERE name LIKE @name AND r.repo LIKE @repo AND ext NOT LIKE 'obsolete'"))) {
 		pk_backend_job_error_code(job, PK_ERROR_ENUM_CANNOT_GET_FILELIST, "%s", sqlite3_errmsg(job_data->db));
 		goto out;
 	}
@@ -388,7 +386,7 @@ pk_backend_get_details_thread(PkBackendJob *job, GVariant *params, gpointer user
 	}
 
 out:
-	sqlite3_finalize(stmt);
+	statement_reset(stmt);
 }
 
 void
@@ -410,14 +408,11 @@ pk_backend_resolve_thread(PkBackendJob *job, GVariant *params, gpointer user_dat
 
 	g_variant_get(params, "(t^a&s)", NULL, &vals);
 
-	if ((sqlite3_prepare_v2(job_data->db,
+	if ((stmt = connection_prepare(job_data->connection,
 							"SELECT (p1.name || ';' || p1.ver || ';' || p1.arch || ';' || r.repo), p1.summary, "
 						   	"p1.full_name FROM pkglist AS p1 NATURAL JOIN repos AS r "
 							"WHERE p1.name LIKE @search AND p1.repo_order = "
-							"(SELECT MIN(p2.repo_order) FROM pkglist AS p2 WHERE p2.name = p1.name GROUP BY p2.name)",
-							-1,
-							&stmt,
-							NULL) == SQLITE_OK)) {
+							"(SELECT MIN(p2.repo_order) FROM pkglist AS p2 WHERE p2.name = p1.name GROUP BY p2.name)"))) {
 		/* Output packages matching each pattern */
 		for (val = vals; *val; val++)
 		{
@@ -440,10 +435,8 @@ pk_backend_resolve_thread(PkBackendJob *job, GVariant *params, gpointer user_dat
 				}
 			}
 
-			sqlite3_clear_bindings(stmt);
-			sqlite3_reset(stmt);
+			statement_reset(stmt);
 		}
-		sqlite3_finalize(stmt);
 	} else {
 		pk_backend_job_error_code(job, PK_ERROR_ENUM_CANNOT_GET_FILELIST, "%s", sqlite3_errmsg(job_data->db));
 	}
@@ -739,31 +732,28 @@ pk_backend_remove_packages(PkBackend *backend,
 static void
 pk_backend_get_updates_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
 {
-	gchar *pkg_id, *full_name, *desc;
+	gchar *pkg_id;
 	const gchar *pkg_metadata_filename;
 	GFile *pkg_metadata_dir;
 	GFileEnumerator *pkg_metadata_enumerator;
 	GFileInfo *pkg_metadata_file_info;
 	GError *err = NULL;
-	sqlite3_stmt *stmt;
+	sqlite3_stmt *insert_stmt = NULL, *stmt = NULL;
 	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
 
 	pk_backend_job_set_status(job, PK_STATUS_ENUM_QUERY);
 
-	if ((sqlite3_prepare_v2(job_data->db,
-							"SELECT p1.full_name, p1.name, p1.ver, p1.arch, r.repo, p1.summary, p1.ext "
-							"FROM pkglist AS p1 NATURAL JOIN repos AS r "
-							"WHERE p1.name LIKE @name AND p1.repo_order = "
-							"(SELECT MIN(p2.repo_order) FROM pkglist AS p2 WHERE p2.name = p1.name GROUP BY p2.name)",
-							-1,
-							&stmt,
-							NULL) != SQLITE_OK))
+	if (!installed_table_reset(job_data->db)
+	 || !(insert_stmt = connection_prepare(job_data->connection,
+	                                       "INSERT INTO temp.installed (full_name, name, ver, arch) VALUES (?, ?, ?, ?)"))
+	 || !(stmt = connection_prepare(job_data->connection, updates_query)))
 	{
 		pk_backend_job_error_code(job, PK_ERROR_ENUM_CANNOT_GET_FILELIST, "%s", sqlite3_errmsg(job_data->db));
 		goto out;
 	}
 
-	/* Read the package metadata directory and comprare all installed packages with ones in the cache */
+	/* Read the package metadata directory into the temporary table, so all installed
+	 * packages can be compared with ones in the cache in a single query */
 	pkg_metadata_dir = g_file_new_for_path("/var/log/packages");
 	pkg_metadata_enumerator = g_file_enumerate_children(pkg_metadata_dir, "standard::name",
 														 G_FILE_QUERY_INFO_NONE,
@@ -777,67 +767,62 @@ pk_backend_get_updates_thread(PkBackendJob *job, GVariant *params, gpointer user
 		goto out;
 	}
 
+	sqlite3_exec(job_data->db, "BEGIN TRANSACTION", NULL, NULL, NULL);
 	while ((pkg_metadata_file_info = g_file_enumerator_next_file(pkg_metadata_enumerator, NULL, NULL)))
 	{
 		gchar **tokens;
 
 		pkg_metadata_filename = g_file_info_get_name(pkg_metadata_file_info);
-		tokens = split_package_name(pkg_metadata_filename);
-
-		/* Select the package from the database */
-		sqlite3_bind_text(stmt, 1, tokens[0], -1, SQLITE_TRANSIENT);
-
-		/* If there are more packages with the same name, remember the one from the
-		 * repository with the lowest order. */
-		if ((sqlite3_step(stmt) == SQLITE_ROW)
-		 || g_slist_find_custom(repos, ((gchar *) sqlite3_column_text(stmt, 4)), cmp_repo))
+		if ((tokens = split_package_name(pkg_metadata_filename)))
 		{
+			sqlite3_bind_text(insert_stmt, 1, pkg_metadata_filename, -1, SQLITE_TRANSIENT);
+			sqlite3_bind_text(insert_stmt, 2, tokens[PK_PACKAGE_ID_NAME], -1, SQLITE_TRANSIENT);
+			sqlite3_bind_text(insert_stmt, 3, tokens[PK_PACKAGE_ID_VERSION], -1, SQLITE_TRANSIENT);
+			sqlite3_bind_text(insert_stmt, 4, tokens[PK_PACKAGE_ID_ARCH], -1, SQLITE_TRANSIENT);
+			sqlite3_step(insert_stmt);
+			statement_reset(insert_stmt);
 
-			full_name = g_strdup((gchar *) sqlite3_column_text(stmt, 0));
-
-			if (!g_strcmp0((gchar *) sqlite3_column_text(stmt, 6), "obsolete"))
-			{ /* Remove if obsolete */
-				pkg_id = pk_package_id_build(tokens[PK_PACKAGE_ID_NAME],
-											 tokens[PK_PACKAGE_ID_VERSION],
-											 tokens[PK_PACKAGE_ID_ARCH],
-											 "obsolete");
-				/* TODO:
-				 * 1: Use the repository name instead of "obsolete" above and check in pk_backend_update_packages()
-				      if the package is obsolete or not
-				 * 2: Get description from /var/log/packages, not from the database */
-				desc = g_strdup((gchar *) sqlite3_column_text(stmt, 5));
-
-				pk_backend_job_package(job, PK_INFO_ENUM_REMOVING, pkg_id, desc);
-
-				g_free(desc);
-				g_free(pkg_id);
-			}
-			else if (g_strcmp0(pkg_metadata_filename, full_name))
-			{ /* Update available */
-				pkg_id = pk_package_id_build((gchar *) sqlite3_column_text(stmt, 1),
-											 (gchar *) sqlite3_column_text(stmt, 2),
-											 (gchar *) sqlite3_column_text(stmt, 3),
-											 (gchar *) sqlite3_column_text(stmt, 4));
-				desc = g_strdup((gchar *) sqlite3_column_text(stmt, 5));
-
-				pk_backend_job_package(job, PK_INFO_ENUM_NORMAL, pkg_id, desc);
-
-				g_free(desc);
-				g_free(pkg_id);
-			}
-			g_free(full_name);
+			g_strfreev(tokens);
 		}
-
-		sqlite3_clear_bindings(stmt);
-		sqlite3_reset(stmt);
-
-		g_strfreev(tokens);
 		g_object_unref(pkg_metadata_file_info);
 	}
+	sqlite3_exec(job_data->db, "END TRANSACTION", NULL, NULL, NULL);
 	g_object_unref(pkg_metadata_enumerator);
 
+	/* Each row is an installed package with the package of the same name from the
+	 * repository with the lowest order */
+	while (sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		if (!g_strcmp0((gchar *) sqlite3_column_text(stmt, 10), "obsolete"))
+		{ /* Remove if obsolete */
+			pkg_id = pk_package_id_build((gchar *) sqlite3_column_text(stmt, 1),
+										 (gchar *) sqlite3_column_text(stmt, 2),
+										 (gchar *) sqlite3_column_text(stmt, 3),
+										 "obsolete");
+			/* TODO:
+			 * 1: Use the repository name instead of "obsolete" above and check in pk_backend_update_packages()
+			      if the package is obsolete or not
+			 * 2: Get description from /var/log/packages, not from the database */
+			pk_backend_job_package(job, PK_INFO_ENUM_REMOVING, pkg_id,
+			                       (gchar *) sqlite3_column_text(stmt, 9));
+			g_free(pkg_id);
+		}
+		else if (g_strcmp0((gchar *) sqlite3_column_text(stmt, 0),
+		                   (gchar *) sqlite3_column_text(stmt, 4)))
+		{ /* Update available */
+			pkg_id = pk_package_id_build((gchar *) sqlite3_column_text(stmt, 5),
+										 (gchar *) sqlite3_column_text(stmt, 6),
+										 (gchar *) sqlite3_column_text(stmt, 7),
+										 (gchar *) sqlite3_column_text(stmt, 8));
+			pk_backend_job_package(job, PK_INFO_ENUM_NORMAL, pkg_id,
+			                       (gchar *) sqlite3_column_text(stmt, 9));
+			g_free(pkg_id);
+		}
+	}
+
 out:
-	sqlite3_finalize(stmt);
+	statement_reset(insert_stmt);
+	statement_reset(stmt);
 }
 
 void
@@ -1,4 +1,5 @@
 #include "job.h"
+#include "utils.h"
 
 using namespace slack;
 
@@ -26,6 +27,113 @@ test_filter_package_none ()
 	g_assert_true (filter_package (filters, true));
 }
 
+static void
+test_generate_query_bound ()
+{
+	std::string query = generate_query ("name", pk_bitfield_value (PK_FILTER_ENUM_APPLICATION));
+
+	g_assert_nonnull (g_strstr_len (query.c_str (), -1, "p1.name LIKE '%' || ?1 || '%'"));
+	g_assert_nonnull (g_strstr_len (query.c_str (), -1, "'usr/share/applications/%.desktop'"));
+}
+
+static void
+test_connection_prepare_cached ()
+{
+	Connection *connection = connection_acquire (":memory:", NULL);
+	g_assert_nonnull (connection);
+
+	sqlite3_stmt *stmt = connection_prepare (connection, "SELECT ?1");
+	g_assert_nonnull (stmt);
+	g_assert_true (connection_prepare (connection, "SELECT ?1") == stmt);
+	g_assert_null (connection_prepare (connection, "SELECT FROM"));
+
+	statement_reset (stmt);
+	connection_release (connection);
+	g_assert_true (connection_acquire (":memory:", NULL) == connection);
+
+	connection_release (connection);
+	connection_pool_free ();
+}
+
+static void
+test_updates_query ()
+{
+	const guint n_packages = 20000;
+	guint i, n_rows = 0, n_updates = 0;
+	sqlite3 *db;
+	sqlite3_stmt *pkglist_stmt, *installed_stmt, *stmt;
+
+	/* Synthetic metadata: every package in the second repository, every second
+	 * package also in the first one with a newer version */
+	g_assert_cmpint (sqlite3_open (":memory:", &db), ==, SQLITE_OK);
+	g_assert_cmpint (sqlite3_exec (db,
+			"CREATE TABLE repos (repo_order INTEGER PRIMARY KEY AUTOINCREMENT, repo VARCHAR NOT NULL);"
+			"CREATE TABLE pkglist (full_name VARCHAR NOT NULL UNIQUE, name VARCHAR NOT NULL, "
+			"ver VARCHAR NOT NULL, arch VARCHAR DEFAULT NULL, ext VARCHAR DEFAULT NULL, "
+			"summary VARCHAR DEFAULT '', repo_order INTEGER REFERENCES repos(repo_order), "
+			"PRIMARY KEY (name, repo_order));"
+			"INSERT INTO repos (repo) VALUES ('slackware'), ('extra');",
+			NULL, NULL, NULL), ==, SQLITE_OK);
+	g_assert_true (installed_table_reset (db));
+
+	g_assert_cmpint (sqlite3_prepare_v2 (db,
+			"INSERT INTO pkglist (full_name, name, ver, arch, ext, repo_order) "
+			"VALUES (?1 || '-' || ?2 || '-x86_64-1', ?1, ?2, 'x86_64', 'txz', ?3)",
+			-1, &pkglist_stmt, NULL), ==, SQLITE_OK);
+	g_assert_cmpint (sqlite3_prepare_v2 (db,
+			"INSERT INTO temp.installed VALUES (?1 || '-1.0-x86_64-1', ?1, '1.0', 'x86_64')",
+			-1, &installed_stmt, NULL), ==, SQLITE_OK);
+
+	sqlite3_exec (db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+	for (i = 0; i < n_packages; i++)
+	{
+		gchar *name = g_strdup_printf ("package%u", i);
+
+		sqlite3_bind_text (pkglist_stmt, 1, name, -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text (pkglist_stmt, 2, "1.0", -1, SQLITE_STATIC);
+		sqlite3_bind_int (pkglist_stmt, 3, 2);
+		g_assert_cmpint (sqlite3_step (pkglist_stmt), ==, SQLITE_DONE);
+		sqlite3_reset (pkglist_stmt);
+		if (i % 2 == 0)
+		{
+			sqlite3_bind_text (pkglist_stmt, 2, "2.0", -1, SQLITE_STATIC);
+			sqlite3_bind_int (pkglist_stmt, 3, 1);
+			g_assert_cmpint (sqlite3_step (pkglist_stmt), ==, SQLITE_DONE);
+			sqlite3_reset (pkglist_stmt);
+		}
+
+		sqlite3_bind_text (installed_stmt, 1, name, -1, SQLITE_TRANSIENT);
+		g_assert_cmpint (sqlite3_step (installed_stmt), ==, SQLITE_DONE);
+		sqlite3_reset (installed_stmt);
+
+		g_free (name);
+	}
+	sqlite3_exec (db, "END TRANSACTION", NULL, NULL, NULL);
+	sqlite3_finalize (pkglist_stmt);
+	sqlite3_finalize (installed_stmt);
+
+	GTimer *timer = g_timer_new ();
+	g_assert_cmpint (sqlite3_prepare_v2 (db, updates_query, -1, &stmt, NULL), ==, SQLITE_OK);
+	while (sqlite3_step (stmt) == SQLITE_ROW)
+	{
+		n_rows++;
+		if (g_strcmp0 ((const gchar *) sqlite3_column_text (stmt, 0),
+				(const gchar *) sqlite3_column_text (stmt, 4)))
+		{
+			g_assert_cmpstr ((const gchar *) sqlite3_column_text (stmt, 8), ==, "slackware");
+			n_updates++;
+		}
+	}
+	g_test_message ("updates for %u packages in %.3fs", n_packages, g_timer_elapsed (timer, NULL));
+	g_timer_destroy (timer);
+
+	g_assert_cmpuint (n_rows, ==, n_packages);
+	g_assert_cmpuint (n_updates, ==, n_packages / 2);
+
+	sqlite3_finalize (stmt);
+	sqlite3_close (db);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -34,6 +142,9 @@ main (int argc, char *argv[])
 	g_test_add_func ("/slack/filter_package_installed", test_filter_package_installed);
 	g_test_add_func ("/slack/filter_package_not_installed", test_filter_package_not_installed);
 	g_test_add_func ("/slack/filter_package_none", test_filter_package_none);
+	g_test_add_func ("/slack/generate_query_bound", test_generate_query_bound);
+	g_test_add_func ("/slack/connection_prepare_cached", test_connection_prepare_cached);
+	g_test_add_func ("/slack/updates_query", test_updates_query);
 
 	return g_test_run ();
 }
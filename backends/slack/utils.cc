@@ -5,6 +5,132 @@
 
 namespace slack {
 
+/* Connections which aren't used by a job at the moment */
+static GSList *connection_pool = NULL;
+
+/**
+ * slack::connection_acquire:
+ * @filename: metadata database.
+ * @error: a #GError.
+ *
+ * Takes a connection from the pool or opens a new one if the pool is empty.
+ * Opening the database and preparing the statements costs more than most of
+ * the queries the jobs run, so the connections are kept between the jobs.
+ *
+ * Returns: the connection or %NULL on error.
+ **/
+Connection *
+connection_acquire (const gchar *filename, GError **error)
+{
+	Connection *connection;
+
+	if (connection_pool)
+	{
+		connection = static_cast<Connection *> (connection_pool->data);
+		connection_pool = g_slist_delete_link (connection_pool, connection_pool);
+		return connection;
+	}
+
+	connection = new Connection ();
+	if (sqlite3_open (filename, &connection->db) != SQLITE_OK)
+	{
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+				"%s: %s", filename, sqlite3_errmsg (connection->db));
+		sqlite3_close (connection->db);
+		delete connection;
+		return NULL;
+	}
+	/* Some SQLite settings */
+	sqlite3_exec (connection->db, "PRAGMA foreign_keys = ON", NULL, NULL, NULL);
+
+	return connection;
+}
+
+/**
+ * slack::connection_release:
+ * @connection: a connection returned by connection_acquire().
+ *
+ * Gives the connection back to the pool.
+ **/
+void
+connection_release (Connection *connection)
+{
+	g_return_if_fail (connection != NULL);
+
+	connection_pool = g_slist_prepend (connection_pool, connection);
+}
+
+static void
+connection_free (gpointer data)
+{
+	auto connection = static_cast<Connection *> (data);
+
+	for (auto &statement : connection->statements)
+	{
+		sqlite3_finalize (statement.second);
+	}
+	sqlite3_close (connection->db);
+	delete connection;
+}
+
+/**
+ * slack::connection_pool_free:
+ *
+ * Closes all pooled connections.
+ **/
+void
+connection_pool_free ()
+{
+	g_slist_free_full (connection_pool, connection_free);
+	connection_pool = NULL;
+}
+
+/**
+ * slack::connection_prepare:
+ * @connection: a connection.
+ * @query: SQL statement with bound parameters.
+ *
+ * Returns the statement prepared on this connection for @query, compiling it
+ * only the first time it is asked for. The statement belongs to the
+ * connection and should be given back with statement_reset(), not finalized.
+ *
+ * Returns: the statement or %NULL on error.
+ **/
+sqlite3_stmt *
+connection_prepare (Connection *connection, const std::string &query)
+{
+	sqlite3_stmt *stmt;
+	auto cached = connection->statements.find (query);
+
+	if (cached != connection->statements.end ())
+	{
+		return cached->second;
+	}
+	if (sqlite3_prepare_v2 (connection->db, query.c_str (), -1, &stmt, NULL) != SQLITE_OK)
+	{
+		return NULL;
+	}
+	connection->statements.emplace (query, stmt);
+
+	return stmt;
+}
+
+/**
+ * slack::statement_reset:
+ * @stmt: a statement returned by connection_prepare() or %NULL.
+ *
+ * Resets the statement and clears its bindings so the next job can reuse it.
+ **/
+void
+statement_reset (sqlite3_stmt *stmt)
+{
+	if (stmt)
+	{
+		sqlite3_reset (stmt);
+		sqlite3_clear_bindings (stmt);
+	}
+}
+
 /**
  * slack::get_file:
  * @curl: curl easy handle.
@@ -4,17 +4,38 @@
 #include <curl/curl.h>
 #include <pk-backend.h>
 #include <pk-backend-job.h>
+#include <sqlite3.h>
+#include <string>
+#include <unordered_map>
 
 namespace slack {
 
+/* An open metadata database with the statements prepared on it so far */
+struct Connection
+{
+	sqlite3 *db;
+	std::unordered_map<std::string, sqlite3_stmt *> statements;
+};
+
 struct JobData
 {
 	GObjectClass parent_class;
 
 	sqlite3 *db;
 	CURL *curl;
+	Connection *connection;
 };
 
+Connection *connection_acquire (const gchar *filename, GError **error);
+
+void connection_release (Connection *connection);
+
+void connection_pool_free ();
+
+sqlite3_stmt *connection_prepare (Connection *connection, const std::string &query);
+
+void statement_reset (sqlite3_stmt *stmt);
+
 CURLcode get_file (CURL **curl, gchar *source_url, gchar *dest);
 
 gchar **split_package_name (const gchar *pkg_filename);
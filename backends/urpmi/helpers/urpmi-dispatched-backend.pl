@@ -425,6 +425,7 @@ sub refresh_cache {
   my %options = (all => 1);
   
   eval { urpm::media::update_media($urpm, %options, quiet => 0) };
+  eval { update_file_index($urpm) };
   _finished();
 
 }
@@ -583,7 +584,8 @@ sub search_file {
 
   pk_print_status(PK_STATUS_ENUM_QUERY);
 
-  perform_file_search($urpm, \%requested, $search_term, fuzzy => 1);
+  perform_file_search($urpm, \%requested, $search_term);
+  %requested or perform_file_search($urpm, \%requested, $search_term, fuzzy => 1);
 
   foreach (keys %requested) {
     my $p = $urpm->{depslist}[$_];
@@ -649,17 +651,10 @@ sub update_packages {
   $urpm->compute_installed_flags($db);
 
   my %requested;
-
-  # FIXME: ...
-  my @depslist = @{$urpm->{depslist}};
-  foreach my $depslistpkg (@depslist) {
-    foreach my $name (@names) {
-      if ($depslistpkg->name =~ /^$name$/ && $depslistpkg->flag_upgrade) {
-        $requested{$depslistpkg->id} = 1;
-        goto tonext;
-      }
+  foreach my $name (@names) {
+    foreach my $pkg (get_packages_by_name($urpm, $name)) {
+      $requested{$pkg->id} = 1 if $pkg->flag_upgrade;
     }
-    tonext:
   }
   eval {
     perform_installation($urpm, \%requested, map { $_ => 1 } split(',', $args->[0]));
@@ -21,6 +21,8 @@ use urpm::lock;
 use urpmi_backend::tools;
 use urpmi_backend::open_db;
 use MDK::Common;
+use Digest::MD5;
+use Search::Dict;
 use perl_packagekit::enums;
 use perl_packagekit::prints;
 
@@ -30,8 +32,11 @@ our @EXPORT = qw(
 perform_installation 
 perform_file_search 
 perform_requires_search
+update_file_index
 );
 
+my $file_index_dir = "/var/cache/PackageKit/urpmi";
+
 sub perform_installation {
   my ($urpm, $requested, %options) = @_;
   my $state = {};
@@ -186,6 +191,93 @@ sub perform_installation {
   );
 }
 
+# - The files of each medium are indexed in two sorted
+# text files, one by full path and one by basename, so
+# searches never need to decompress the xml info.
+# They are named after the checksum of the synthesis,
+# so an updated medium gets a new index.
+sub _file_index_prefix {
+  my ($urpm, $medium) = @_;
+  my $synthesis = urpm::media::any_synthesis($urpm, $medium) or return;
+  open(my $fh, '<', $synthesis) or return;
+  binmode($fh);
+  "$file_index_dir/files-" . Digest::MD5->new->addfile($fh)->hexdigest;
+}
+
+sub _build_file_index {
+  my ($urpm, $medium, $prefix) = @_;
+  my $xml_info_file = urpm::media::any_xml_info($urpm, $medium, 'files', 0) or return;
+  require urpm::xml_info;
+  require urpm::xml_info_pkg;
+
+  my (@paths, @basenames);
+  my $name;
+  my $F = urpm::xml_info::open_lzma($xml_info_file);
+  local $_;
+  while (<$F>) {
+    chomp;
+    if (m!^<!) {
+      my ($fn) = /fn="(.*)"/;
+      $name = $fn && urpm::xml_info_pkg->new({ fn => $fn })->name;
+    } elsif ($name) {
+      push @paths, "$_\t$name\n";
+      push @basenames, basename($_) . "\t$name\n";
+    }
+  }
+
+  mkdir_p($file_index_dir);
+  foreach ([ 'path', \@paths ], [ 'base', \@basenames ]) {
+    my ($suffix, $lines) = @$_;
+    open(my $out, '>', "$prefix.$suffix.tmp") or return;
+    print $out sort @$lines;
+    close($out) or return;
+    rename("$prefix.$suffix.tmp", "$prefix.$suffix") or return;
+  }
+  1;
+}
+
+sub _get_file_index {
+  my ($urpm, $medium) = @_;
+  my $prefix = _file_index_prefix($urpm, $medium) or return;
+  -e "$prefix.path" && -e "$prefix.base" or _build_file_index($urpm, $medium, $prefix) or return;
+  $prefix;
+}
+
+# - Called after the media were refreshed, so that
+# searches do not have to build the indexes.
+sub update_file_index {
+  my ($urpm) = @_;
+  my %wanted;
+  foreach my $medium (urpm::media::non_ignored_media($urpm)) {
+    my $prefix = _get_file_index($urpm, $medium) or next;
+    $wanted{"$prefix.$_"} = 1 foreach qw(path base);
+  }
+  unlink grep { !$wanted{$_} } glob("$file_index_dir/files-*");
+}
+
+sub _file_index_lookup {
+  my ($file, $key, $result_hash) = @_;
+  open(my $fh, '<', $file) or return;
+  look($fh, "$key\t");
+  local $_;
+  while (<$fh>) {
+    index($_, "$key\t") == 0 or last;
+    chomp;
+    $result_hash->{(split(/\t/))[1]} = 1;
+  }
+}
+
+sub _file_index_scan {
+  my ($file, $search_term, $result_hash) = @_;
+  open(my $fh, '<', $file) or return;
+  local $_;
+  while (<$fh>) {
+    chomp;
+    my ($path, $name) = split(/\t/);
+    index($path, $search_term) >= 0 and $result_hash->{$name} = 1;
+  }
+}
+
 sub perform_file_search {
   my ($urpm, $requested, $search_term, %options) = @_;
   my $db = open_rpm_db();
@@ -193,28 +285,17 @@ sub perform_file_search {
 
   my %result_hash;
 
-  # - For each medium, we browse the xml info file,
-  # while looking for files which matched with the
-  # search term given in argument. We store results 
-  # in a hash.
+  # - An absolute path is looked up exactly, anything
+  # else as a basename, unless a fuzzy search was
+  # asked for, which matches any part of the path.
   foreach my $medium (urpm::media::non_ignored_media($urpm)) {
-    my $xml_info_file = urpm::media::any_xml_info($urpm, $medium, 'files', 0);
-    $xml_info_file or next;
-    require urpm::xml_info;
-    require urpm::xml_info_pkg;
-    my $F = urpm::xml_info::open_lzma($xml_info_file);
-    my $fn;
-    local $_;
-    while (<$F>) {
-      if (m!^<!) {
-        ($fn) = /fn="(.*)"/;
-      } elsif (!$options{fuzzy} && /^$search_term$/
-        || $options{fuzzy} && /$search_term/) {
-        # Fix me : Replace with pk error enum.
-        # $fn or $urpm->{fatal}("fast algorithm is broken, please report a bug");
-        my $pkg = urpm::xml_info_pkg->new({ fn => $fn });
-        $result_hash{$pkg->name} = 1;
-      }
+    my $prefix = _get_file_index($urpm, $medium) or next;
+    if ($options{fuzzy}) {
+      _file_index_scan("$prefix.path", $search_term, \%result_hash);
+    } elsif ($search_term =~ m!^/!) {
+      _file_index_lookup("$prefix.path", $search_term, \%result_hash);
+    } else {
+      _file_index_lookup("$prefix.base", $search_term, \%result_hash);
     }
   }
 
@@ -224,6 +305,7 @@ sub perform_file_search {
   # methods to create the printing output.
   # (It's about the same code as search-name.pl)
   my @names = keys %result_hash;
+  @names or return;
 
   urpm::select::search_packages($urpm, $requested, \@names, 
     fuzzy => 0,
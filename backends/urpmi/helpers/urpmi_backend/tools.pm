@@ -32,6 +32,7 @@ our @EXPORT = qw(
   pkg2medium 
   fullname_to_package_id
   get_package_by_package_id
+  get_packages_by_name
   get_package_upgrade
   get_installed_fullname
   get_installed_fullname_pkid
@@ -131,29 +132,33 @@ sub get_package_by_package_id {
   return;
 }
 
+# depslist ids by name, rebuilt when the media are loaded again
+my ($name_index, $name_index_depslist, $name_index_size);
+
+sub get_packages_by_name {
+  my ($urpm, $name) = @_;
+  my $depslist = $urpm->{depslist};
+  if (!$name_index || $name_index_depslist != $depslist || $name_index_size != @$depslist) {
+    $name_index = {};
+    foreach my $pkg (@$depslist) {
+      push @{$name_index->{$pkg->name}}, $pkg->id;
+    }
+    $name_index_depslist = $depslist;
+    $name_index_size = @$depslist;
+  }
+  map { $depslist->[$_] } @{$name_index->{$name} || []};
+}
+
 sub get_package_upgrade {
   my ($urpm, $pkg) = @_;
   my $db = open_rpm_db();
   $urpm->compute_installed_flags($db);
-  my @depslist = @{$urpm->{depslist}};
-  my $pkgname = $pkg->name;
-  foreach (@depslist) {
-    if ($_->name =~ /^$pkgname$/ && $_->flag_upgrade) {
-      return $_;
-    }
-  }
+  find { $_->flag_upgrade } get_packages_by_name($urpm, $pkg->name);
 }
 
 sub get_installed_fullname {
   my ($urpm, $pkg) = @_;
-  my @depslist = @{$urpm->{depslist}};
-  my $pkgname = $pkg->name;
-  foreach my $pkg (@depslist) {
-    if ($pkg->name =~ /^$pkgname$/ && is_package_installed($pkg)) {
-      return $pkg;
-    }
-  }
-  return;
+  find { is_package_installed($_) } get_packages_by_name($urpm, $pkg->name);
 }
 
 sub get_installed_fullname_pkid {
@@ -167,3 +172,5 @@ sub get_installed_fullname_pkid {
     });
   return $installed_pkid;
 }
+
+1;
@@ -45,10 +45,13 @@ from yum.misc import prco_tuple_to_string, unique
 from yum.packages import YumLocalPackage, parsePackages
 from yum.packageSack import MetaSack
 from yum.Errors import YumBaseError
+from yum.sqlutils import executeSQL
 import rpmUtils
 import exceptions
 import types
 import signal
+import select
+import sys
 import time
 import os.path
 import logging
@@ -88,6 +91,9 @@ StatusPercentageMap = {
 # this isn't defined in yum as it's only used in the rollback plugin
 TS_REPACKAGING = 'repackaging'
 
+# provide names per query, keeping below the sqlite bound parameter limit
+PROVIDES_QUERY_MAX = 500
+
 # Map yum transactions with pk info enums
 TransactionsInfoMap = {
     TS_UPDATE       : INFO_UPDATING,
@@ -262,6 +268,10 @@ class PackageKitYumBackend(PackageKitBaseBackend, PackagekitPackage):
             self.doLock()
 
         self.package_summary_cache = {}
+        self.updates_sack_key = None
+        self.changelog_prefetch = []
+        self.obsoleted_map = {}
+        self.obsoleted_map_key = None
         self.comps = yumComps(self.yumbase)
         if not self.comps.connect():
             self.refresh_cache(True)
@@ -905,6 +915,70 @@ class PackageKitYumBackend(PackageKitBaseBackend, PackagekitPackage):
         # not supported
         raise PkError(ERROR_NOT_SUPPORTED, "this backend does not support '%s' provides" % provides_type)
 
+    def _is_provide_name(self, provide):
+        '''
+        Only plain provide names can be matched exactly, files, versioned
+        provides and globs need searchProvides
+        '''
+        if provide.startswith('/'):
+            return False
+        for c in provide:
+            if c.isspace() or c in '<>=*?[':
+                return False
+        return True
+
+    def _search_installed_provides(self, provides):
+        '''
+        Search the rpmdb for packages providing any of the provide strings
+        in one pass over the installed packages
+        '''
+        names = set([provide for provide in provides if self._is_provide_name(provide)])
+        pkgs = []
+        if names:
+            for pkg in self.yumbase.rpmdb.returnPackages():
+                if not names.isdisjoint(pkg.provides_names):
+                    pkgs.append(pkg)
+
+        # versioned provides, globs and files are looked up the old way
+        for provide in provides:
+            if not self._is_provide_name(provide):
+                pkgs.extend(self.yumbase.rpmdb.searchProvides(provide))
+        return pkgs
+
+    def _search_available_provides(self, provides):
+        '''
+        Search the repositories for packages providing any of the provide
+        strings with one query per repository rather than one per string
+        '''
+        names = unique([_to_unicode(provide) for provide in provides if self._is_provide_name(provide)])
+        others = [provide for provide in provides if not self._is_provide_name(provide)]
+        pkgs = []
+
+        sacks = getattr(self.yumbase.pkgSack, 'sacks', {}).values()
+        if not sacks:
+            others = provides
+        for sack in sacks:
+            # only the sqlite sacks can be queried directly
+            if not hasattr(sack, 'primarydb'):
+                for provide in names:
+                    pkgs.extend(sack.searchProvides(provide))
+                continue
+            for (repo, cache) in sack.primarydb.items():
+                for i in range(0, len(names), PROVIDES_QUERY_MAX):
+                    chunk = names[i:i + PROVIDES_QUERY_MAX]
+                    cur = cache.cursor()
+                    executeSQL(cur, "SELECT DISTINCT pkgKey FROM provides WHERE name IN (%s)" %
+                               ", ".join(["?"] * len(chunk)), chunk)
+                    for row in cur:
+                        pkg = sack._packageByKey(repo, row[0])
+                        if pkg:
+                            pkgs.append(pkg)
+
+        # versioned provides, globs and files are looked up the old way
+        for provide in others:
+            pkgs.extend(self.yumbase.pkgSack.searchProvides(provide))
+        return unique(pkgs)
+
     def what_provides(self, filters, provides_type, values):
         '''
         Implement the what-provides functionality
@@ -930,29 +1004,27 @@ class PackageKitYumBackend(PackageKitBaseBackend, PackagekitPackage):
         except PkError, e:
             self.error(e.code, e.details, exit=False)
         else:
-            # there may be multiple provide strings
-            for provide in values_provides:
-                # Check installed packages for provide
-                try:
-                    pkgs = self.yumbase.rpmdb.searchProvides(provide)
-                except Exception, e:
-                    self.error(ERROR_INTERNAL_ERROR, _format_str(traceback.format_exc()))
-                else:
-                    pkgfilter.add_installed(pkgs)
+            # there may be multiple provide strings, search for all at once
+            try:
+                pkgs = self._search_installed_provides(values_provides)
+            except Exception, e:
+                self.error(ERROR_INTERNAL_ERROR, _format_str(traceback.format_exc()))
+            else:
+                pkgfilter.add_installed(pkgs)
 
-                    if not FILTER_INSTALLED in filters:
-                        # Check available packages for provide
-                        try:
-                            pkgs = self.yumbase.pkgSack.searchProvides(provide)
-                        except yum.Errors.RepoError, e:
-                            self.error(ERROR_NO_CACHE, "failed to get provides for sack: %s" %_to_unicode(e), exit=False)
-                            return
-                        except exceptions.IOError, e:
-                            self.error(ERROR_NO_SPACE_ON_DEVICE, "Disk error: %s" % _to_unicode(e))
-                        except Exception, e:
-                            self.error(ERROR_INTERNAL_ERROR, _format_str(traceback.format_exc()))
-                        else:
-                            pkgfilter.add_available(pkgs)
+                if not FILTER_INSTALLED in filters:
+                    # Check available packages for provide
+                    try:
+                        pkgs = self._search_available_provides(values_provides)
+                    except yum.Errors.RepoError, e:
+                        self.error(ERROR_NO_CACHE, "failed to get provides for sack: %s" %_to_unicode(e), exit=False)
+                        return
+                    except exceptions.IOError, e:
+                        self.error(ERROR_NO_SPACE_ON_DEVICE, "Disk error: %s" % _to_unicode(e))
+                    except Exception, e:
+                        self.error(ERROR_INTERNAL_ERROR, _format_str(traceback.format_exc()))
+                    else:
+                        pkgfilter.add_available(pkgs)
 
         # we couldn't do this when generating the list
         package_list = pkgfilter.get_package_list()
@@ -973,7 +1045,7 @@ class PackageKitYumBackend(PackageKitBaseBackend, PackagekitPackage):
         self.allow_cancel(True)
         cats = []
         try:
-            cats = self.yumbase.comps.categories
+            cats = self.comps.get_categories(self.lang)
         except yum.Errors.RepoError, e:
             self.error(ERROR_NO_CACHE, "failed to get comps list: %s" %_to_unicode(e), exit=False)
         except yum.Errors.GroupsError, e:
@@ -986,20 +1058,8 @@ class PackageKitYumBackend(PackageKitBaseBackend, PackagekitPackage):
             if len(cats) == 0:
                 self.error(ERROR_GROUP_LIST_INVALID, "no comps categories", exit=False)
                 return
-            for cat in cats:
-                cat_id = cat.categoryid
-                # yum >= 3.2.10
-                # name = cat.nameByLang(self.lang)
-                # summary = cat.descriptionByLang(self.lang)
-                name = _to_unicode(cat.name)
-                summary = _to_unicode(cat.description)
-                fn = "/usr/share/pixmaps/comps/%s.png" % cat_id
-                if os.access(fn, os.R_OK):
-                    icon = cat_id
-                else:
-                    icon = "image-missing"
-                self.category("", cat_id, name, summary, icon)
-                self._get_groups(cat_id)
+            for (parent_id, cat_id, name, summary, icon) in cats:
+                self.category(parent_id, cat_id, name, summary, icon)
 
         # also add the repo category objects
         self.category("", 'repo:', 'Software Repositories', 'Packages from specific software repositories', 'base-system')
@@ -1015,42 +1075,6 @@ class PackageKitYumBackend(PackageKitBaseBackend, PackagekitPackage):
             if repo.isEnabled():
                 self.category("repo:", "repo:" + repo.id, repo.name, 'Packages from ' + repo.name, 'base-system')
 
-    def _get_groups(self, cat_id):
-        '''
-        Implement the get-collections functionality
-        '''
-        self.status(STATUS_QUERY)
-        self.allow_cancel(True)
-        if cat_id:
-            cats = [cat_id]
-        else:
-            cats =  [cat.categoryid for cat in self.yumbase.comps.categories]
-        for cat in cats:
-            grps = []
-            for grp_id in self.comps.get_groups(cat):
-                try:
-                    grp = self.yumbase.comps.return_group(grp_id)
-                except exceptions.IOError, e:
-                    self.error(ERROR_NO_SPACE_ON_DEVICE, "Disk error: %s" % _to_unicode(e))
-                except Exception, e:
-                    self.error(ERROR_INTERNAL_ERROR, _format_str(traceback.format_exc()))
-                if grp:
-                    grps.append(grp)
-            for grp in sorted(grps):
-                grp_id = grp.groupid
-                cat_id_name = "@%s" % (grp_id)
-                name = grp.nameByLang(self.lang)
-                summary = grp.descriptionByLang(self.lang)
-                icon = "image-missing"
-                fn = "/usr/share/pixmaps/comps/%s.png" % grp_id
-                if os.access(fn, os.R_OK):
-                    icon = grp_id
-                else:
-                    fn = "/usr/share/pixmaps/comps/%s.png" % cat_id
-                    if os.access(fn, os.R_OK):
-                        icon = cat_id
-                self.category(cat, cat_id_name, name, summary, icon)
-
     def download_packages(self, directory, package_ids):
         '''
         Implement the download-packages functionality
@@ -1792,8 +1816,9 @@ class PackageKitYumBackend(PackageKitBaseBackend, PackagekitPackage):
         except Exception, e:
             self.error(ERROR_INTERNAL_ERROR, _format_str(traceback.format_exc()))
         else:
-            # update the comps groups too
-            self.comps.refresh()
+            # update the comps groups and the category tree too
+            if self.comps.refresh():
+                self.comps.get_categories(self.lang)
 
     def resolve(self, filters, packages):
         '''
@@ -2653,11 +2678,13 @@ class PackageKitYumBackend(PackageKitBaseBackend, PackagekitPackage):
         self.percentage(None)
         self.status(STATUS_INFO)
 
-        # yum 'helpfully' keeps an array of updates available
-        self.yumbase.up = None
-
-        # clear the package sack so we can get new updates
-        self.yumbase.pkgSack = None
+        # only reload the sack and the array of updates yum 'helpfully' keeps
+        # when the repo metadata or the rpmdb changed since the last call
+        sack_key = self._get_updates_sack_key()
+        if sack_key is None or sack_key != self.updates_sack_key:
+            self.yumbase.up = None
+            self.yumbase.pkgSack = None
+            self.changelog_prefetch = []
 
         package_list = []
         pkgfilter = YumFilter(filters)
@@ -2680,19 +2707,10 @@ class PackageKitYumBackend(PackageKitBaseBackend, PackagekitPackage):
             installed_dict[pkgtup_installed[0]] = pkgtup_installed
 
         md = self.updateMetadata
+        prefetch = []
         for pkg in unique(pkgs):
             if pkgfilter._filter_base(pkg):
-                # we pre-get the ChangeLog data so that the changes file is
-                # downloaded at GetUpdates time, not when we open the GUI
-                # get each element of the ChangeLog
-                try:
-                    changelog = pkg.returnChangelog()
-                except yum.Errors.RepoError, e:
-                    self.error(ERROR_REPO_NOT_AVAILABLE, _to_unicode(e))
-                except exceptions.IOError, e:
-                    self.error(ERROR_NO_SPACE_ON_DEVICE, "Disk error: %s" % _to_unicode(e))
-                except Exception, e:
-                    self.error(ERROR_INTERNAL_ERROR, _format_str(traceback.format_exc()))
+                prefetch.append(pkg)
 
                 # fall back to this if there is no installed update or there is no metadata
                 status = INFO_NORMAL
@@ -2710,6 +2728,55 @@ class PackageKitYumBackend(PackageKitBaseBackend, PackagekitPackage):
 
         package_list = pkgfilter.get_package_list()
         self._show_package_list(package_list)
+        self.updates_sack_key = sack_key
+
+        # the ChangeLog data is pre-got once the updates have been sent, so
+        # the changes file is downloaded before we open the GUI, see idle()
+        if self.has_network:
+            self.changelog_prefetch = prefetch
+
+    def _get_updates_sack_key(self):
+        '''
+        Identify the repo metadata and rpmdb the package sack was built from
+        '''
+        key = []
+        try:
+            for repo in self.yumbase.repos.listEnabled():
+                primary = repo.repoXML.getData('primary')
+                repomd = os.path.join(repo.cachedir, 'repomd.xml')
+                mtime = None
+                if os.path.exists(repomd):
+                    mtime = os.stat(repomd).st_mtime
+                key.append((repo.id, primary.checksum, mtime))
+            key.append(self.yumbase.rpmdb.simpleVersion()[0])
+        except Exception, e:
+            return None
+        return key
+
+    def idle(self):
+        '''
+        Pre-get the ChangeLog data for the last GetUpdates between commands
+        '''
+        if not self.changelog_prefetch:
+            return False
+        pkg = self.changelog_prefetch[0]
+
+        # nothing may be emitted between commands, and the download has to
+        # give way to the next one
+        self.yumbase.repos.setProgressBar(IdleDownloadCallback())
+        try:
+            pkg.returnChangelog()
+        except KeyboardInterrupt, e:
+            # a command arrived, carry on once it has finished
+            return False
+        except Exception, e:
+            # GetUpdateDetail tries again and reports the error
+            self.changelog_prefetch = []
+            return False
+        finally:
+            self.yumbase.repos.setProgressBar(self.dnlCallback)
+        self.changelog_prefetch.pop(0)
+        return True
 
     def repo_enable(self, repoid, enable):
         '''
@@ -2771,19 +2838,43 @@ class PackageKitYumBackend(PackageKitBaseBackend, PackagekitPackage):
                 enabled = repo.isEnabled()
                 self.repo_detail(repo.id, repo.name, enabled)
 
-    def _get_obsoleted(self, name):
+    def _get_obsoleted_map(self):
+        '''
+        Map the obsoleting package names to the installed package tuples they
+        obsolete, only worked out again when the sack or rpmdb changed
+        '''
+        sack_key = self._get_updates_sack_key()
+        if sack_key is not None and sack_key == self.obsoleted_map_key:
+            return self.obsoleted_map
+
+        obsoleted = {}
         try:
             # make sure yum doesn't explode in some internal fit of rage
             self.yumbase.up.doObsoletes()
             obsoletes = self.yumbase.up.getObsoletesTuples(newest=1)
             for (obsoleting, installed) in obsoletes:
-                if obsoleting[0] == name:
-                    pkg =  self.yumbase.rpmdb.searchPkgTuple(installed)[0]
-                    return self._pkg_to_id(pkg)
+                # like the old linear scan, the first match wins
+                if not obsoleted.has_key(obsoleting[0]):
+                    obsoleted[obsoleting[0]] = installed
         except exceptions.IOError, e:
             self.error(ERROR_NO_SPACE_ON_DEVICE, "Disk error: %s" % _to_unicode(e))
         except Exception, e:
             pass # no obsolete data - fd#17528
+
+        self.obsoleted_map = obsoleted
+        self.obsoleted_map_key = sack_key
+        return obsoleted
+
+    def _get_obsoleted(self, name, obsoleted):
+        if not obsoleted.has_key(name):
+            return ""
+        try:
+            pkg = self.yumbase.rpmdb.searchPkgTuple(obsoleted[name])[0]
+            return self._pkg_to_id(pkg)
+        except exceptions.IOError, e:
+            self.error(ERROR_NO_SPACE_ON_DEVICE, "Disk error: %s" % _to_unicode(e))
+        except Exception, e:
+            pass
         return ""
 
     def _get_updated(self, pkg):
@@ -2878,6 +2969,7 @@ class PackageKitYumBackend(PackageKitBaseBackend, PackagekitPackage):
         self.allow_cancel(True)
         self.percentage(None)
         self.status(STATUS_INFO)
+        obsoleted = self._get_obsoleted_map()
         for package_id in package_ids:
             try:
                 pkg, inst = self._findPackage(package_id)
@@ -2891,7 +2983,7 @@ class PackageKitYumBackend(PackageKitBaseBackend, PackagekitPackage):
                 self.message('COULD_NOT_FIND_PACKAGE', "could not find %s" % _format_package_id(package_id))
                 continue
             update = self._get_updated(pkg)
-            obsolete = self._get_obsoleted(pkg.name)
+            obsolete = self._get_obsoleted(pkg.name, obsoleted)
             desc, urls, reboot, changelog, state, issued, updated = self._get_update_extras(pkg)
 
             # the metadata stores broken ISO8601 formatted values
@@ -3092,6 +3184,13 @@ class PackageKitYumBackend(PackageKitBaseBackend, PackagekitPackage):
         self.dnlCallback = DownloadCallback(self, showNames=True)
         self.yumbase.repos.setProgressBar(self.dnlCallback)
 
+class IdleDownloadCallback(BaseMeter):
+    """ Silent progress meter that gives up when the daemon sends a command """
+    def update(self, amount_read, now=None):
+        # urlgrabber aborts the transfer and raises KeyboardInterrupt
+        if select.select([sys.stdin], [], [], 0)[0]:
+            raise KeyboardInterrupt
+
 class DownloadCallback(BaseMeter):
     """ Customized version of urlgrabber.progress.BaseMeter class """
     def __init__(self, base, showNames = False):
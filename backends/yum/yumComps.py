@@ -22,8 +22,9 @@ from packagekit.enums import *
 import sqlite3
 import os
 import yum
+from yum.i18n import to_unicode
 
-__DB_VER__ = '1'
+__DB_VER__ = '2'
 class yumComps:
 
     def __init__(self, yumbase, db = None):
@@ -97,6 +98,7 @@ class yumComps:
             print e
         else:
             self.cursor.execute('CREATE TABLE groups (name TEXT, category TEXT, groupid TEXT, group_enum TEXT, pkgtype Text);')
+            self.cursor.execute('CREATE TABLE categories (key TEXT, lang TEXT, parent_id TEXT, cat_id TEXT, name TEXT, summary TEXT, icon TEXT);')
             self.cursor.execute('CREATE TABLE version (version TEXT);')
             self.cursor.execute('INSERT INTO version values(?);', __DB_VER__)
             self.connection.commit()
@@ -119,6 +121,7 @@ class yumComps:
 
         # delete old data else we get multiple entries
         self.cursor.execute('DELETE FROM groups;')
+        self.cursor.execute('DELETE FROM categories;')
 
         # store to sqlite
         for category in cats:
@@ -216,3 +219,60 @@ class yumComps:
             grps.add(row[0])
         return list(grps)
 
+    def _get_comps_key(self):
+        ''' identify the comps data the category tree is built from '''
+        key = []
+        for repo in self.yumbase.repos.listEnabled():
+            for mdtype in ('group', 'group_gz'):
+                try:
+                    checksum = repo.repoXML.getData(mdtype).checksum[1]
+                except Exception, e:
+                    continue
+                key.append('%s:%s' % (repo.id, checksum))
+        return ';'.join(key)
+
+    def _get_icon(self, ids):
+        ''' use the first comps id that has an icon '''
+        for icon in ids:
+            if os.access("/usr/share/pixmaps/comps/%s.png" % icon, os.R_OK):
+                return icon
+        return "image-missing"
+
+    def _refresh_categories(self, key, lang):
+        ''' resolve the category and group tree for a language (slow) '''
+        cats = []
+        for cat in self.yumbase.comps.categories:
+            cat_id = cat.categoryid
+            # yum >= 3.2.10
+            # name = cat.nameByLang(lang)
+            # summary = cat.descriptionByLang(lang)
+            cats.append(("", cat_id, to_unicode(cat.name),
+                         to_unicode(cat.description), self._get_icon([cat_id])))
+            grps = []
+            for grp_id in self.get_groups(cat_id):
+                grp = self.yumbase.comps.return_group(grp_id)
+                if grp:
+                    grps.append(grp)
+            for grp in sorted(grps):
+                cats.append((cat_id, "@%s" % grp.groupid,
+                             to_unicode(grp.nameByLang(lang)),
+                             to_unicode(grp.descriptionByLang(lang)),
+                             self._get_icon([grp.groupid, cat_id])))
+
+        # only keep other languages that were built from the same comps
+        self.cursor.execute('DELETE FROM categories WHERE key != ? OR lang = ?;', (key, lang))
+        for cat in cats:
+            self.cursor.execute('INSERT INTO categories values(?, ?, ?, ?, ?, ?, ?);', (key, lang) + cat)
+        self.connection.commit()
+        return cats
+
+    def get_categories(self, lang):
+        ''' get the (parent_id, cat_id, name, summary, icon) tree for a language '''
+        key = self._get_comps_key()
+        cats = []
+        self.cursor.execute('SELECT parent_id, cat_id, name, summary, icon FROM categories WHERE key = ? AND lang = ? ORDER BY rowid;', (key, lang))
+        for row in self.cursor:
+            cats.append(tuple(row))
+        if not cats:
+            cats = self._refresh_categories(key, lang)
+        return cats
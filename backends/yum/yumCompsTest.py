@@ -44,6 +44,13 @@ def main():
     print 40 * "="
     _pkgs = comps.get_groups('other')
     print _pkgs
+    print "category tree"
+    print 40 * "="
+    _cats = comps.get_categories('en')
+    print _cats
+    print "category tree (cached)"
+    print 40 * "="
+    assert comps.get_categories('en') == _cats
     os.unlink(_db) # kill the db
 
 if __name__ == "__main__":
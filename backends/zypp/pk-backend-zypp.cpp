@@ -90,6 +90,8 @@
 #include <zypp/target/rpm/librpmDb.h>
 #include <zypp/ui/Selectable.h>
 
+#include "zypp-pool-lock.h"
+
 using namespace std;
 using namespace zypp;
 using zypp::filesystem::PathInfo;
@@ -106,9 +108,14 @@ typedef enum {
 
 class ZyppJob {
  public:
-	ZyppJob(PkBackendJob *job);
+	ZyppJob(PkBackendJob *job, gboolean read_only = FALSE);
 	~ZyppJob();
 	zypp::ZYpp::Ptr get_zypp();
+	gboolean is_shared() { return shared; }
+ private:
+	PkBackendJob *job;
+	gboolean read_only;
+	gboolean shared;
 };
 
 enum PkgSearchType {
@@ -547,17 +554,117 @@ class PkBackendZYppPrivate {
 	EventDirector eventDirector;
 	PkBackendJob *currentJob;
 	
-	pthread_mutex_t zypp_mutex;
+	/* shared by jobs that only query a built pool */
+	ZyppPoolLock pool_lock;
 };
 
 }; // namespace ZyppBackend
 
 using namespace ZyppBackend;
 
-ZyppJob::ZyppJob(PkBackendJob *job)
+/**
+ * zypp_job_set_environment:
+ *
+ * Sets the locale and proxies of the job, which have to be unset again
+ * with zypp_job_unset_environment().
+ */
+static void
+zypp_job_set_environment (PkBackendJob *job)
 {
+	const gchar *locale;
+	const gchar *proxy_http;
+	const gchar *proxy_https;
+	const gchar *proxy_ftp;
+	const gchar *proxy_socks;
+	const gchar *no_proxy;
+	const gchar *pac;
+	gchar *uri;
+
+	locale = pk_backend_job_get_locale(job);
+	if (!pk_strzero (locale)) {
+		setlocale(LC_ALL, locale);
+	}
+
+	/* http_proxy */
+	proxy_http = pk_backend_job_get_proxy_http (job);
+	if (!pk_strzero (proxy_http)) {
+		uri = pk_backend_convert_uri (proxy_http);
+		g_setenv ("http_proxy", uri, TRUE);
+		g_free (uri);
+	}
+
+	/* https_proxy */
+	proxy_https = pk_backend_job_get_proxy_https (job);
+	if (!pk_strzero (proxy_https)) {
+		uri = pk_backend_convert_uri (proxy_https);
+		g_setenv ("https_proxy", uri, TRUE);
+		g_free (uri);
+	}
+
+	/* ftp_proxy */
+	proxy_ftp = pk_backend_job_get_proxy_ftp (job);
+	if (!pk_strzero (proxy_ftp)) {
+		uri = pk_backend_convert_uri (proxy_ftp);
+		g_setenv ("ftp_proxy", uri, TRUE);
+		g_free (uri);
+	}
+
+	/* socks_proxy */
+	proxy_socks = pk_backend_job_get_proxy_socks (job);
+	if (!pk_strzero (proxy_socks)) {
+		uri = pk_backend_convert_uri (proxy_socks);
+		g_setenv ("socks_proxy", uri, TRUE);
+		g_free (uri);
+	}
+
+	/* no_proxy */
+	no_proxy = pk_backend_job_get_no_proxy (job);
+	if (!pk_strzero (no_proxy)) {
+		g_setenv ("no_proxy", no_proxy, TRUE);
+	}
+
+	/* pac */
+	pac = pk_backend_job_get_pac (job);
+	if (!pk_strzero (pac)) {
+		uri = pk_backend_convert_uri (pac);
+		g_setenv ("pac", uri, TRUE);
+		g_free (uri);
+	}
+}
+
+/**
+ * zypp_job_unset_environment:
+ */
+static void
+zypp_job_unset_environment (void)
+{
+	/* unset proxy info for this transaction */
+	g_unsetenv ("http_proxy");
+	g_unsetenv ("ftp_proxy");
+	g_unsetenv ("https_proxy");
+	g_unsetenv ("no_proxy");
+	g_unsetenv ("socks_proxy");
+	g_unsetenv ("pac");
+}
+
+ZyppJob::ZyppJob(PkBackendJob *job, gboolean read_only)
+	: job(job), read_only(read_only), shared(FALSE)
+{
+	/* queries can run alongside each other once the pool is built, but
+	 * building it and everything else needs zypp to itself. Shared
+	 * queries never refresh or download, so nothing reports through the
+	 * event director, which stays detached while they run */
+	shared = priv->pool_lock.lock(read_only);
+	if (shared) {
+		MIL << "sharing zypp" << std::endl;
+		return;
+	}
+
 	MIL << "locking zypp" << std::endl;
-	pthread_mutex_lock(&priv->zypp_mutex);
+
+	/* the locale and proxies are process wide, so only set them while
+	 * no other job is running */
+	zypp_job_set_environment (job);
 
 	if (priv->currentJob) {
 		MIL << "currentjob is already defined - highly impossible" << endl;
@@ -570,12 +677,19 @@ ZyppJob::ZyppJob(PkBackendJob *job)
 
 ZyppJob::~ZyppJob()
 {
+	if (shared) {
+		MIL << "unsharing zypp" << std::endl;
+		priv->pool_lock.unlock(shared, read_only);
+		return;
+	}
+
 	if (priv->currentJob)
 		pk_backend_job_set_locked(priv->currentJob, false);
 	priv->currentJob = 0;
 	priv->eventDirector.setJob(0);
+	zypp_job_unset_environment ();
 	MIL << "unlocking zypp" << std::endl;
-	pthread_mutex_unlock(&priv->zypp_mutex);
+	priv->pool_lock.unlock(shared, read_only);
 }
 
 /**
@@ -599,10 +713,10 @@ ZyppJob::get_zypp()
 			initialized = TRUE;
 		}
 	} catch (const ZYppFactoryException &ex) {
-		pk_backend_job_error_code (priv->currentJob, PK_ERROR_ENUM_FAILED_INITIALIZATION, "%s", ex.asUserString().c_str() );
+		pk_backend_job_error_code (job, PK_ERROR_ENUM_FAILED_INITIALIZATION, "%s", ex.asUserString().c_str() );
 		return NULL;
 	} catch (const Exception &ex) {
-		pk_backend_job_error_code (priv->currentJob, PK_ERROR_ENUM_INTERNAL_ERROR, "%s", ex.asUserString().c_str() );
+		pk_backend_job_error_code (job, PK_ERROR_ENUM_INTERNAL_ERROR, "%s", ex.asUserString().c_str() );
 		return NULL;
 	}
 
@@ -691,6 +805,21 @@ zypp_is_valid_repo (PkBackendJob *job, RepoInfo repo)
  * Build and return a ResPool that contains all local resolvables
  * and ones found in the enabled repositories.
  */
+/**
+ * Mark the pool as ready to be shared by queries, after doing the lazy
+ * setup that they would otherwise all race to do themselves
+ */
+static void
+zypp_pool_ready (ZYpp::Ptr zypp, gboolean include_local)
+{
+	if (!include_local || priv->pool_lock.is_ready ())
+		return;
+
+	sat::Pool::instance ().prepare ();
+	zypp->poolProxy ();
+	priv->pool_lock.set_ready ();
+}
+
 ResPool
 zypp_build_pool (ZYpp::Ptr zypp, gboolean include_local)
 {
@@ -715,8 +844,10 @@ zypp_build_pool (ZYpp::Ptr zypp, gboolean include_local)
 	}
 
 	// we only load repositories once.
-	if (repos_loaded)
+	if (repos_loaded) {
+		zypp_pool_ready (zypp, include_local);
 		return zypp->pool();
+	}
 
 	// Add resolvables from enabled repos
 	RepoManager manager;
@@ -738,6 +869,7 @@ zypp_build_pool (ZYpp::Ptr zypp, gboolean include_local)
 
 		}
 		repos_loaded = true;
+		zypp_pool_ready (zypp, include_local);
 	} catch (const repo::RepoNoAliasException &ex) {
 		g_error ("Can't figure an alias to look in cache");
 	} catch (const repo::RepoNotCachedException &ex) {
@@ -749,22 +881,6 @@ zypp_build_pool (ZYpp::Ptr zypp, gboolean include_local)
 	return zypp->pool ();
 }
 
-/**
-  * Return the rpmHeader of a package
-  */
-target::rpm::RpmHeader::constPtr
-zypp_get_rpmHeader (const string &name, Edition edition)
-{
-	target::rpm::librpmDb::db_const_iterator it;
-	target::rpm::RpmHeader::constPtr result = new target::rpm::RpmHeader ();
-
-	for (it.findPackage (name, edition); *it; ++it) {
-		result = *it;
-	}
-
-	return result;
-}
-
 /**
   * Return the PkEnumGroup of the given PoolItem.
   */
@@ -1674,12 +1790,12 @@ zypp_backend_finished_error (PkBackendJob  *job, PkErrorEnum err_code,
 
 
 /**
- * We do not pretend we're thread safe when all we do is having a huge mutex
+ * Queries share a built pool, everything else still runs on its own
  */
 gboolean
 pk_backend_supports_parallelization (PkBackend *backend)
 {
-        return FALSE;
+        return TRUE;
 }
 
 
@@ -1714,7 +1830,6 @@ pk_backend_initialize (GKeyFile *conf, PkBackend *backend)
 	/* create private area */
 	priv = new PkBackendZYppPrivate;
 	priv->currentJob = 0;
-	priv->zypp_mutex = PTHREAD_MUTEX_INITIALIZER;
 	zypp_logging ();
 
 	g_debug ("zypp_backend_initialize");
@@ -2029,7 +2144,7 @@ backend_get_details_thread (PkBackendJob *job, GVariant *params, gpointer user_d
 	g_variant_get (params, "(^a&s)",
 		       &package_ids);
 
-	ZyppJob zjob(job);
+	ZyppJob zjob(job, TRUE);
 	ZYpp::Ptr zypp = zjob.get_zypp();
 
 	if (zypp == NULL){
@@ -2756,7 +2871,7 @@ backend_resolve_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
 		      &_filters,
 		      &search);
 
-	ZyppJob zjob(job);
+	ZyppJob zjob(job, TRUE);
 	ZYpp::Ptr zypp = zjob.get_zypp();
 	
 	if (zypp == NULL){
@@ -2849,15 +2964,16 @@ backend_find_packages_thread (PkBackendJob *job, GVariant *params, gpointer user
 		&_filters,
 		&values);
 
-	ZyppJob zjob(job);
+	ZyppJob zjob(job, TRUE);
 	ZYpp::Ptr zypp = zjob.get_zypp();
 	
 	if (zypp == NULL){
 		return;
 	}
 
-	// refresh the repos before searching
-	if (!zypp_refresh_cache (job, zypp, FALSE)) {
+	// refresh the repos before searching, unless other queries are
+	// using the pool this was built from
+	if (!zjob.is_shared () && !zypp_refresh_cache (job, zypp, FALSE)) {
 		return;
 	}
 
@@ -2943,7 +3059,7 @@ backend_search_group_thread (PkBackendJob *job, GVariant *params, gpointer user_
 		&_filters,
 		&search);
 
-	ZyppJob zjob(job);
+	ZyppJob zjob(job, TRUE);
 	ZYpp::Ptr zypp = zjob.get_zypp();
 
 	if (zypp == NULL){
@@ -3001,19 +3117,19 @@ pk_backend_search_files (PkBackend *backend, PkBackendJob *job, PkBitfield filte
 	pk_backend_job_thread_create (job, backend_find_packages_thread, NULL, NULL);
 }
 
-/**
- * backend_get_repo_list:
- */
-void
-pk_backend_get_repo_list (PkBackend *backend, PkBackendJob *job, PkBitfield filters)
+static void
+backend_get_repo_list_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
 {
+	PkBitfield filters;
+	g_variant_get (params, "(t)",
+		       &filters);
+
 	MIL << endl;
 
 	ZyppJob zjob(job);
 	ZYpp::Ptr zypp = zjob.get_zypp();
 
 	if (zypp == NULL){
-		pk_backend_job_finished (job);
 		return;
 	}
 
@@ -3045,23 +3161,32 @@ pk_backend_get_repo_list (PkBackend *backend, PkBackendJob *job, PkBitfield filt
 					it->name().c_str(),
 					it->enabled());
 	}
-
-	pk_backend_job_finished (job);
 }
 
 /**
- * pk_backend_repo_enable:
+ * backend_get_repo_list:
  */
 void
-pk_backend_repo_enable (PkBackend *backend, PkBackendJob *job, const gchar *rid, gboolean enabled)
+pk_backend_get_repo_list (PkBackend *backend, PkBackendJob *job, PkBitfield filters)
+{
+	pk_backend_job_thread_create (job, backend_get_repo_list_thread, NULL, NULL);
+}
+
+static void
+backend_repo_enable_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
 {
+	const gchar *rid;
+	gboolean enabled;
+	g_variant_get (params, "(&sb)",
+		       &rid,
+		       &enabled);
+
 	MIL << endl;
-	
+
 	ZyppJob zjob(job);
 	ZYpp::Ptr zypp = zjob.get_zypp();
 
 	if (zypp == NULL){
-		pk_backend_job_finished (job);
 		return;
 	}
 	pk_backend_job_set_status (job, PK_STATUS_ENUM_QUERY);
@@ -3072,7 +3197,6 @@ pk_backend_repo_enable (PkBackend *backend, PkBackendJob *job, const gchar *rid,
 	try {
 		repo = manager.getRepositoryInfo (rid);
 		if (!zypp_is_valid_repo (job, repo)){
-			pk_backend_job_finished (job);
 			return;
 		}
 		repo.setEnabled (enabled);
@@ -3091,10 +3215,66 @@ pk_backend_repo_enable (PkBackend *backend, PkBackendJob *job, const gchar *rid,
 			job, PK_ERROR_ENUM_INTERNAL_ERROR, ex.asUserString().c_str());
 		return;
 	}
+}
 
-	pk_backend_job_finished (job);
+/**
+ * pk_backend_repo_enable:
+ */
+void
+pk_backend_repo_enable (PkBackend *backend, PkBackendJob *job, const gchar *rid, gboolean enabled)
+{
+	pk_backend_job_thread_create (job, backend_repo_enable_thread, NULL, NULL);
 }
 
+/**
+  * Emit the file list of a package, joined into a single string
+  */
+static void
+zypp_emit_files (PkBackendJob *job, const gchar *package_id, const list<string> &files)
+{
+	string temp;
+	for (list<string>::const_iterator it = files.begin (); it != files.end (); ++it) {
+		temp.append (*it);
+		temp.append (";");
+	}
+
+	const gchar *to_strv[] = { NULL, NULL };
+	to_strv[0] = temp.c_str ();
+	pk_backend_job_files (job, package_id, (gchar **) to_strv);	// file_list
+}
+
+/**
+  * Key an installed package by name, edition and arch, so that the
+  * multilib variants of a package keep their own file lists
+  */
+static string
+zypp_get_files_key (const string &name, const Edition &edition, const Arch &arch)
+{
+	return name + "-" + edition.asString () + "." + arch.asString ();
+}
+
+/**
+  * Emit the file list of an rpmdb header for the ids waiting on it
+  */
+static void
+zypp_emit_header_files (PkBackendJob *job, map<string, vector<const gchar *> > &installed,
+			target::rpm::RpmHeader::constPtr header)
+{
+	map<string, vector<const gchar *> >::iterator found =
+		installed.find (zypp_get_files_key (header->tag_name (), header->tag_edition (), header->tag_arch ()));
+	if (found == installed.end ())
+		return;
+
+	list<string> files = header->tag_filenames ();
+	for (vector<const gchar *>::iterator id = found->second.begin (); id != found->second.end (); ++id)
+		zypp_emit_files (job, *id, files);
+	installed.erase (found);
+}
+
+/* below this many installed packages each one is looked up through the
+ * rpmdb name index, above it a single pass over the rpmdb is cheaper */
+#define ZYPP_GET_FILES_INDEXED_MAX	16
+
 static void
 backend_get_files_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
 {
@@ -3111,8 +3291,11 @@ backend_get_files_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 		return;
 	}
 
+	pk_backend_job_set_status (job, PK_STATUS_ENUM_QUERY);
+
+	map<string, vector<const gchar *> > installed;
+	vector<sat::Solvable> lookups;
 	for (uint i = 0; package_ids[i]; i++) {
-		pk_backend_job_set_status (job, PK_STATUS_ENUM_QUERY);
 		sat::Solvable solvable = zypp_get_package_by_id (package_ids[i]);
 		
 		if (zypp_is_no_solvable(solvable)) {
@@ -3122,30 +3305,43 @@ backend_get_files_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 			return;
 		}
 
-		string temp;
-		if (solvable.isSystem ()){
-			try {
-				target::rpm::RpmHeader::constPtr rpmHeader = zypp_get_rpmHeader (solvable.name (), solvable.edition ());
-				list<string> files = rpmHeader->tag_filenames ();
+		if (solvable.isSystem ()) {
+			vector<const gchar *> &ids = installed[zypp_get_files_key (solvable.name (), solvable.edition (), solvable.arch ())];
+			if (ids.empty ())
+				lookups.push_back (solvable);
+			ids.push_back (package_ids[i]);
+			continue;
+		}
 
-				for (list<string>::iterator it = files.begin (); it != files.end (); ++it) {
-					temp.append (*it);
-					temp.append (";");
-				}
+		list<string> files;
+		files.push_back ("Only available for installed packages");
+		zypp_emit_files (job, package_ids[i], files);
+	}
 
-			} catch (const target::rpm::RpmException &ex) {
-				zypp_backend_finished_error (job, PK_ERROR_ENUM_REPO_NOT_FOUND,
-							     "Couldn't open rpm-database");
-				return;
+	if (installed.empty ())
+		return;
+
+	try {
+		target::rpm::librpmDb::db_const_iterator it;
+		if (lookups.size () <= ZYPP_GET_FILES_INDEXED_MAX) {
+			for (vector<sat::Solvable>::iterator s = lookups.begin (); s != lookups.end (); ++s) {
+				for (it.findPackage (s->name (), s->edition ()); *it; ++it)
+					zypp_emit_header_files (job, installed, *it);
 			}
 		} else {
-			temp = "Only available for installed packages";
+			for (it.findAll (); *it && !installed.empty (); ++it)
+				zypp_emit_header_files (job, installed, *it);
 		}
-
-		const gchar *to_strv[] = { NULL, NULL };
-		to_strv[0] = temp.c_str ();
-		pk_backend_job_files (job, package_ids[i], (gchar **) to_strv);	// file_list
+	} catch (const target::rpm::RpmException &ex) {
+		zypp_backend_finished_error (job, PK_ERROR_ENUM_REPO_NOT_FOUND,
+					     "Couldn't open rpm-database");
+		return;
 	}
+
+	/* not in the rpmdb after all, so there are no files to list */
+	for (map<string, vector<const gchar *> >::iterator it = installed.begin (); it != installed.end (); ++it)
+		for (vector<const gchar *>::iterator id = it->second.begin (); id != it->second.end (); ++id)
+			zypp_emit_files (job, *id, list<string> ());
 }
 
 /**
@@ -3166,7 +3362,7 @@ backend_get_packages_thread (PkBackendJob *job, GVariant *params, gpointer user_
 	g_variant_get (params, "(t)",
 		       &_filters);
 
-	ZyppJob zjob(job);
+	ZyppJob zjob(job, TRUE);
 	ZYpp::Ptr zypp = zjob.get_zypp();
 
 	if (zypp == NULL){
@@ -3434,7 +3630,9 @@ backend_what_provides_thread (PkBackendJob *job, GVariant *params, gpointer user
 		      &_filters,
 		      &values);
 	
-	ZyppJob zjob(job);
+	/* the driver lookup runs the solver, which changes resolvable
+	 * status, so it can not share the pool with other readers */
+	ZyppJob zjob(job, g_ascii_strcasecmp ("drivers_for_attached_hardware", values[0]) != 0);
 	ZYpp::Ptr zypp = zjob.get_zypp();
 
 	if (zypp == NULL){
@@ -3621,89 +3819,6 @@ pk_backend_download_packages (PkBackend *backend, PkBackendJob *job, gchar **pac
 	pk_backend_job_thread_create (job, backend_download_packages_thread, NULL, NULL);
 }
 
-/**
- * pk_backend_start_job:
- */
-void
-pk_backend_start_job (PkBackend *backend, PkBackendJob *job)
-{
-	const gchar *locale;
-	const gchar *proxy_http;
-	const gchar *proxy_https;
-	const gchar *proxy_ftp;
-	const gchar *proxy_socks;
-	const gchar *no_proxy;
-	const gchar *pac;
-	gchar *uri;
-
-	locale = pk_backend_job_get_locale(job);
-	if (!pk_strzero (locale)) {
-		setlocale(LC_ALL, locale);
-	}
-
-	/* http_proxy */
-	proxy_http = pk_backend_job_get_proxy_http (job);
-	if (!pk_strzero (proxy_http)) {
-		uri = pk_backend_convert_uri (proxy_http);
-		g_setenv ("http_proxy", uri, TRUE);
-		g_free (uri);
-	}
-
-	/* https_proxy */
-	proxy_https = pk_backend_job_get_proxy_https (job);
-	if (!pk_strzero (proxy_https)) {
-		uri = pk_backend_convert_uri (proxy_https);
-		g_setenv ("https_proxy", uri, TRUE);
-		g_free (uri);
-	}
-
-	/* ftp_proxy */
-	proxy_ftp = pk_backend_job_get_proxy_ftp (job);
-	if (!pk_strzero (proxy_ftp)) {
-		uri = pk_backend_convert_uri (proxy_ftp);
-		g_setenv ("ftp_proxy", uri, TRUE);
-		g_free (uri);
-	}
-
-	/* socks_proxy */
-	proxy_socks = pk_backend_job_get_proxy_socks (job);
-	if (!pk_strzero (proxy_socks)) {
-		uri = pk_backend_convert_uri (proxy_socks);
-		g_setenv ("socks_proxy", uri, TRUE);
-		g_free (uri);
-	}
-
-	/* no_proxy */
-	no_proxy = pk_backend_job_get_no_proxy (job);
-	if (!pk_strzero (no_proxy)) {
-		g_setenv ("no_proxy", no_proxy, TRUE);
-	}
-
-	/* pac */
-	pac = pk_backend_job_get_pac (job);
-	if (!pk_strzero (pac)) {
-		uri = pk_backend_convert_uri (pac);
-		g_setenv ("pac", uri, TRUE);
-		g_free (uri);
-	}
-}
-
-/**
- * pk_backend_stop_job:
- */
-void
-pk_backend_stop_job (PkBackend *backend, PkBackendJob *job)
-{
-	/* unset proxy info for this transaction */
-	g_unsetenv ("http_proxy");
-	g_unsetenv ("ftp_proxy");
-	g_unsetenv ("https_proxy");
-	g_unsetenv ("no_proxy");
-	g_unsetenv ("socks_proxy");
-	g_unsetenv ("pac");
-}
-
-
 /**
   * Ask the User if it is OK to import an GPG-Key for a repo
   */
@@ -0,0 +1,156 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The PackageKit Authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "zypp-pool-lock.h"
+
+using namespace ZyppBackend;
+
+static ZyppPoolLock *pool_lock;
+static gint inside;
+static gint max_inside;
+static GMutex order_mutex;
+static GString *order;
+
+static void
+test_record (const gchar *event)
+{
+	g_mutex_lock (&order_mutex);
+	g_string_append (order, event);
+	g_mutex_unlock (&order_mutex);
+}
+
+/* a query that holds the pool for a while */
+static gpointer
+test_query_thread (gpointer user_data)
+{
+	gboolean shared = pool_lock->lock (TRUE);
+	gint now = g_atomic_int_add (&inside, 1) + 1;
+
+	/* remember the most queries that were ever inside at once */
+	for (gint max = g_atomic_int_get (&max_inside);
+	     now > max && !g_atomic_int_compare_and_exchange (&max_inside, max, now);
+	     max = g_atomic_int_get (&max_inside));
+	test_record ((const gchar *) user_data);
+	g_usleep (200 * 1000);
+	g_atomic_int_add (&inside, -1);
+	pool_lock->unlock (shared, TRUE);
+	return GINT_TO_POINTER (shared);
+}
+
+static gpointer
+test_writer_thread (gpointer user_data)
+{
+	gboolean shared = pool_lock->lock (FALSE);
+	test_record ("W");
+	g_usleep (50 * 1000);
+	pool_lock->unlock (shared, FALSE);
+	return GINT_TO_POINTER (shared);
+}
+
+static void
+test_reset (void)
+{
+	delete pool_lock;
+	pool_lock = new ZyppPoolLock ();
+	inside = 0;
+	max_inside = 0;
+	g_string_truncate (order, 0);
+}
+
+static void
+test_unbuilt_pool_is_exclusive (void)
+{
+	gboolean shared;
+
+	test_reset ();
+
+	/* the first query has to build the pool */
+	shared = pool_lock->lock (TRUE);
+	g_assert (!shared);
+	pool_lock->set_ready ();
+	pool_lock->unlock (shared, TRUE);
+	g_assert (pool_lock->is_ready ());
+
+	/* after that it is shared */
+	shared = pool_lock->lock (TRUE);
+	g_assert (shared);
+	pool_lock->unlock (shared, TRUE);
+
+	/* and any other job makes it unbuilt again */
+	shared = pool_lock->lock (FALSE);
+	g_assert (!shared);
+	pool_lock->unlock (shared, FALSE);
+	g_assert (!pool_lock->is_ready ());
+}
+
+static void
+test_queries_overlap (void)
+{
+	GThread *threads[3];
+
+	test_reset ();
+	pool_lock->set_ready ();
+
+	for (guint i = 0; i < G_N_ELEMENTS (threads); i++)
+		threads[i] = g_thread_new ("query", test_query_thread, (gpointer) "Q");
+	for (guint i = 0; i < G_N_ELEMENTS (threads); i++)
+		g_assert (GPOINTER_TO_INT (g_thread_join (threads[i])));
+	g_assert_cmpint (max_inside, ==, G_N_ELEMENTS (threads));
+}
+
+static void
+test_writer_is_preferred (void)
+{
+	GThread *first;
+	GThread *writer;
+	GThread *second;
+
+	test_reset ();
+	pool_lock->set_ready ();
+
+	/* a writer waiting behind one query goes before a later query */
+	first = g_thread_new ("query", test_query_thread, (gpointer) "A");
+	g_usleep (50 * 1000);
+	writer = g_thread_new ("writer", test_writer_thread, NULL);
+	g_usleep (50 * 1000);
+	second = g_thread_new ("query", test_query_thread, (gpointer) "B");
+
+	g_assert (GPOINTER_TO_INT (g_thread_join (first)));
+	g_assert (!GPOINTER_TO_INT (g_thread_join (writer)));
+
+	/* the writer left the pool unbuilt, so the late query rebuilt it */
+	g_assert (!GPOINTER_TO_INT (g_thread_join (second)));
+	g_assert_cmpstr (order->str, ==, "AWB");
+	g_assert_cmpint (max_inside, ==, 1);
+}
+
+int
+main (int argc, char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+	order = g_string_new (NULL);
+
+	g_test_add_func ("/zypp/pool-lock/unbuilt", test_unbuilt_pool_is_exclusive);
+	g_test_add_func ("/zypp/pool-lock/overlap", test_queries_overlap);
+	g_test_add_func ("/zypp/pool-lock/writer-preferred", test_writer_is_preferred);
+
+	return g_test_run ();
+}
@@ -0,0 +1,67 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The PackageKit Authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "zypp-pool-lock.h"
+
+using namespace ZyppBackend;
+
+ZyppPoolLock::ZyppPoolLock()
+	: ready(FALSE)
+{
+	pthread_rwlockattr_t attr;
+
+	pthread_rwlockattr_init(&attr);
+	pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+	pthread_rwlock_init(&rwlock, &attr);
+	pthread_rwlockattr_destroy(&attr);
+}
+
+ZyppPoolLock::~ZyppPoolLock()
+{
+	pthread_rwlock_destroy(&rwlock);
+}
+
+/**
+ * Returns TRUE if the pool is shared with other queries, or FALSE if the
+ * caller has zypp to itself. A query that finds the pool not yet built
+ * gets it to itself, so that it can build it.
+ */
+gboolean
+ZyppPoolLock::lock(gboolean read_only)
+{
+	if (read_only) {
+		pthread_rwlock_rdlock(&rwlock);
+		if (ready)
+			return TRUE;
+		pthread_rwlock_unlock(&rwlock);
+	}
+	pthread_rwlock_wrlock(&rwlock);
+	return FALSE;
+}
+
+void
+ZyppPoolLock::unlock(gboolean shared, gboolean read_only)
+{
+	/* anything but a query may have changed the pool */
+	if (!shared && !read_only)
+		ready = FALSE;
+	pthread_rwlock_unlock(&rwlock);
+}
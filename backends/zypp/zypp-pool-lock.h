@@ -0,0 +1,51 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The PackageKit Authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ZYPP_POOL_LOCK_H
+#define __ZYPP_POOL_LOCK_H
+
+#include <glib.h>
+#include <pthread.h>
+
+namespace ZyppBackend
+{
+
+/**
+ * Guards the zypp pool. Jobs that only query a pool which has been built
+ * share it, everything else has zypp to itself. Waiting writers are
+ * preferred, so a stream of queries cannot hold off an install forever.
+ */
+class ZyppPoolLock {
+ public:
+	ZyppPoolLock();
+	~ZyppPoolLock();
+	gboolean lock(gboolean read_only);
+	void unlock(gboolean shared, gboolean read_only);
+	void set_ready() { ready = TRUE; }
+	gboolean is_ready() { return ready; }
+ private:
+	pthread_rwlock_t rwlock;
+	gboolean ready;
+};
+
+}; // namespace ZyppBackend
+
+#endif /* __ZYPP_POOL_LOCK_H */
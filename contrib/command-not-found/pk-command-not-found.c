@@ -30,6 +30,7 @@
 #include <glib/gi18n.h>
 #include <packagekit-glib2/packagekit.h>
 #include <packagekit-glib2/packagekit-private.h>
+#include <packagekit-glib2/pk-cnf-index-private.h>
 
 #define PK_MAX_PATH_LEN 1023
 
@@ -470,6 +471,35 @@ pk_cnf_cancel_cb (GCancellable *_cancellable)
 	return FALSE;
 }
 
+/**
+ * pk_cnf_find_in_index:
+ *
+ * Find software we could install using the index kept by the daemon,
+ * which does not need a transaction.
+ *
+ * Return value: the package IDs, or %NULL if the index cannot be used or
+ * does not know the command, as it may be older than the repositories.
+ **/
+static gchar **
+pk_cnf_find_in_index (const gchar *cmd)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(PkCnfIndex) index = NULL;
+	g_auto(GStrv) package_ids = NULL;
+
+	index = pk_cnf_index_new_from_file (PK_CNF_INDEX_FILENAME, &error);
+	if (index == NULL) {
+		g_debug ("not using index: %s", error->message);
+		return NULL;
+	}
+	package_ids = pk_cnf_index_lookup (index, cmd);
+	if (g_strv_length (package_ids) == 0) {
+		g_debug ("%s not in index", cmd);
+		return NULL;
+	}
+	return g_steal_pointer (&package_ids);
+}
+
 /**
  * pk_cnf_find_available:
  *
@@ -887,9 +917,11 @@ main (int argc, char *argv[])
 		goto out;
 
 	/* only search using PackageKit if configured to do so */
-	} else if (config->software_source_search &&
-		   pk_cnf_is_backend_fast_enough_to_do_search ()) {
-		package_ids = pk_cnf_find_available (argv[1], config->max_search_time);
+	} else if (config->software_source_search) {
+		package_ids = pk_cnf_find_in_index (argv[1]);
+		if (package_ids == NULL &&
+		    pk_cnf_is_backend_fast_enough_to_do_search ())
+			package_ids = pk_cnf_find_available (argv[1], config->max_search_time);
 		if (package_ids == NULL)
 			goto out;
 		len = g_strv_length (package_ids);
@@ -0,0 +1,14 @@
+#!/bin/sh
+# Copyright (C) 2026 The PackageKit Authors
+# Licensed under the GNU General Public License Version 2
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+
+# acknowledge binary framing, then write a stray text line into the stream
+printf "framing\tbinary\n"
+printf "found repos\n"
+
+# the daemon has to kill us to get out of this
+sleep 10
@@ -29,21 +29,33 @@
  * http://www.packagekit.org/gtk-doc/introduction-ideas-transactions.html
  */
 
+/* for the file sealing fcntls */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "config.h"
 
+#include <fcntl.h>
 #include <gio/gio.h>
+#include <gio/gunixfdlist.h>
 #include <glib-object.h>
 #include <locale.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <packagekit-glib2/pk-client.h>
 #include <packagekit-glib2/pk-client-helper.h>
 #include <packagekit-glib2/pk-common.h>
+#include <packagekit-glib2/pk-common-private.h>
 #include <packagekit-glib2/pk-control.h>
 #include <packagekit-glib2/pk-debug.h>
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-package-id.h>
 #include <packagekit-glib2/pk-package-ids.h>
+#include <packagekit-glib2/pk-task.h>
 
 static void     pk_client_finalize	(GObject     *object);
 
@@ -51,6 +63,18 @@ static void     pk_client_finalize	(GObject     *object);
 
 #define PK_CLIENT_DBUS_METHOD_TIMEOUT	G_MAXINT /* ms */
 
+/* the BulkResults fds of the transactions that asked for them, which the
+ * connection filter collects in the GDBus worker thread */
+typedef struct {
+	GMutex			 mutex;
+	GHashTable		*fds;		/* tid : PkClientBulkFd */
+} PkClientBulkResults;
+
+typedef struct {
+	gchar			*sender;
+	gint			 fd;
+} PkClientBulkFd;
+
 /**
  * PkClientPrivate:
  *
@@ -59,6 +83,9 @@ static void     pk_client_finalize	(GObject     *object);
 struct _PkClientPrivate
 {
 	GDBusConnection		*connection;
+	PkClientBulkResults	*bulk;
+	guint			 bulk_filter_id;
+	gboolean		 bulk_results;
 	GPtrArray		*calls;
 	PkControl		*control;
 	gchar			*locale;
@@ -66,6 +93,9 @@ struct _PkClientPrivate
 	gboolean		 interactive;
 	gboolean		 idle;
 	guint			 cache_age;
+	PkClientStreamCallback	 stream_callback;
+	gpointer		 stream_user_data;
+	GDestroyNotify		 stream_destroy_func;
 };
 
 enum {
@@ -75,6 +105,7 @@ enum {
 	PROP_INTERACTIVE,
 	PROP_IDLE,
 	PROP_CACHE_AGE,
+	PROP_BULK_RESULTS,
 	PROP_LAST
 };
 
@@ -120,6 +151,7 @@ typedef struct {
 	PkUpgradeKindEnum		 upgrade_kind;
 	guint				 refcount;
 	PkClientHelper			*client_helper;
+	gboolean			 stream;
 } PkClientState;
 
 static void
@@ -170,6 +202,9 @@ pk_client_get_property (GObject *object, guint prop_id, GValue *value, GParamSpe
 	case PROP_CACHE_AGE:
 		g_value_set_uint (value, priv->cache_age);
 		break;
+	case PROP_BULK_RESULTS:
+		g_value_set_boolean (value, priv->bulk_results);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -199,6 +234,9 @@ pk_client_set_property (GObject *object, guint prop_id, const GValue *value, GPa
 	case PROP_CACHE_AGE:
 		priv->cache_age = g_value_get_uint (value);
 		break;
+	case PROP_BULK_RESULTS:
+		priv->bulk_results = g_value_get_boolean (value);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -631,6 +669,135 @@ pk_client_state_add (PkClient *client, PkClientState *state)
 	}
 }
 
+/*
+ * pk_client_bulk_fd_free:
+ **/
+static void
+pk_client_bulk_fd_free (PkClientBulkFd *bulk_fd)
+{
+	if (bulk_fd->fd >= 0)
+		close (bulk_fd->fd);
+	g_free (bulk_fd->sender);
+	g_free (bulk_fd);
+}
+
+/*
+ * pk_client_bulk_results_free:
+ **/
+static void
+pk_client_bulk_results_free (PkClientBulkResults *bulk)
+{
+	g_hash_table_unref (bulk->fds);
+	g_mutex_clear (&bulk->mutex);
+	g_free (bulk);
+}
+
+/*
+ * pk_client_bulk_results_filter_cb:
+ *
+ * This runs in the GDBus worker thread, as the fd list of a signal is only
+ * available to a connection filter and not in GDBusProxy::g-signal.
+ **/
+static GDBusMessage *
+pk_client_bulk_results_filter_cb (GDBusConnection *connection,
+				  GDBusMessage *message,
+				  gboolean incoming,
+				  gpointer user_data)
+{
+	PkClientBulkResults *bulk = (PkClientBulkResults *) user_data;
+	PkClientBulkFd *bulk_fd;
+	GUnixFDList *fd_list;
+
+	if (!incoming ||
+	    g_dbus_message_get_message_type (message) != G_DBUS_MESSAGE_TYPE_SIGNAL ||
+	    g_strcmp0 (g_dbus_message_get_member (message), "BulkResults") != 0 ||
+	    g_strcmp0 (g_dbus_message_get_interface (message), PK_DBUS_INTERFACE_TRANSACTION) != 0)
+		return message;
+	fd_list = g_dbus_message_get_unix_fd_list (message);
+	if (fd_list == NULL || g_unix_fd_list_get_length (fd_list) != 1)
+		return message;
+
+	/* only accept the fd from the daemon running the transaction */
+	g_mutex_lock (&bulk->mutex);
+	bulk_fd = g_hash_table_lookup (bulk->fds, g_dbus_message_get_path (message));
+	if (bulk_fd != NULL && bulk_fd->fd < 0 &&
+	    g_strcmp0 (bulk_fd->sender, g_dbus_message_get_sender (message)) == 0)
+		bulk_fd->fd = g_unix_fd_list_get (fd_list, 0, NULL);
+	g_mutex_unlock (&bulk->mutex);
+	return message;
+}
+
+/*
+ * pk_client_bulk_results_watch:
+ *
+ * Return value: %TRUE if the fd of the BulkResults signal can be received
+ **/
+static gboolean
+pk_client_bulk_results_watch (PkClientState *state)
+{
+	PkClientPrivate *priv = state->client->priv;
+	GDBusConnection *connection = g_dbus_proxy_get_connection (state->proxy);
+	PkClientBulkFd *bulk_fd;
+	g_autofree gchar *sender = NULL;
+
+	if ((g_dbus_connection_get_capabilities (connection) &
+	     G_DBUS_CAPABILITY_FLAGS_UNIX_FD_PASSING) == 0)
+		return FALSE;
+	sender = g_dbus_proxy_get_name_owner (state->proxy);
+	if (sender == NULL)
+		return FALSE;
+
+	/* one filter is shared by all the transactions of the client */
+	if (priv->bulk == NULL) {
+		priv->bulk = g_new0 (PkClientBulkResults, 1);
+		g_mutex_init (&priv->bulk->mutex);
+		priv->bulk->fds = g_hash_table_new_full (g_str_hash, g_str_equal,
+							 g_free,
+							 (GDestroyNotify) pk_client_bulk_fd_free);
+		priv->connection = g_object_ref (connection);
+		priv->bulk_filter_id = g_dbus_connection_add_filter (connection,
+								     pk_client_bulk_results_filter_cb,
+								     priv->bulk,
+								     (GDestroyNotify) pk_client_bulk_results_free);
+	} else if (priv->connection != connection) {
+		return FALSE;
+	}
+
+	bulk_fd = g_new0 (PkClientBulkFd, 1);
+	bulk_fd->sender = g_steal_pointer (&sender);
+	bulk_fd->fd = -1;
+	g_mutex_lock (&priv->bulk->mutex);
+	g_hash_table_insert (priv->bulk->fds, g_strdup (state->tid), bulk_fd);
+	g_mutex_unlock (&priv->bulk->mutex);
+	return TRUE;
+}
+
+/*
+ * pk_client_bulk_results_steal:
+ *
+ * Return value: the fd of the BulkResults signal of the transaction, or -1
+ **/
+static gint
+pk_client_bulk_results_steal (PkClientState *state)
+{
+	PkClientPrivate *priv = state->client->priv;
+	PkClientBulkFd *bulk_fd;
+	gint fd = -1;
+
+	if (priv->bulk == NULL || state->tid == NULL)
+		return -1;
+
+	g_mutex_lock (&priv->bulk->mutex);
+	bulk_fd = g_hash_table_lookup (priv->bulk->fds, state->tid);
+	if (bulk_fd != NULL) {
+		fd = bulk_fd->fd;
+		bulk_fd->fd = -1;
+		g_hash_table_remove (priv->bulk->fds, state->tid);
+	}
+	g_mutex_unlock (&priv->bulk->mutex);
+	return fd;
+}
+
 /*
  * pk_client_state_finish:
  **/
@@ -638,8 +805,14 @@ static void
 pk_client_state_finish (PkClientState *state, const GError *error)
 {
 	gboolean ret;
+	gint fd;
 	g_autoptr(GError) error_local = NULL;
 
+	/* stop waiting for bulk results */
+	fd = pk_client_bulk_results_steal (state);
+	if (fd >= 0)
+		close (fd);
+
 	/* force finished (if not already set) so clients can update the UI's */
 	ret = pk_progress_set_status (state->progress, PK_STATUS_ENUM_FINISHED);
 	if (ret && state->progress_callback != NULL) {
@@ -746,25 +919,33 @@ pk_client_signal_package (PkClientState *state,
 			  const gchar *summary)
 {
 	gboolean ret;
+	PkClientPrivate *priv = state->client->priv;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(PkPackage) package = NULL;
 
-	/* create virtual package */
-	package = pk_package_new ();
-	if (!pk_package_set_id (package, package_id, &error)) {
+	if (!pk_package_id_check (package_id)) {
 		g_warning ("failed to set package id for %s", package_id);
 		return;
 	}
-	g_object_set (package,
-		      "info", info_enum,
-		      "summary", summary,
-		      "role", state->role,
-		      "transaction-id", state->transaction_id,
-		      NULL);
 
-	/* add to results */
-	if (state->results != NULL && info_enum != PK_INFO_ENUM_FINISHED)
-		pk_results_add_package (state->results, package);
+	/* stream to the caller, or add to results without creating an
+	 * object for each package */
+	if (state->stream && priv->stream_callback != NULL &&
+	    info_enum != PK_INFO_ENUM_FINISHED) {
+		PkClientStreamItem item = { 0 };
+		item.info = info_enum;
+		item.package_id = package_id;
+		item.summary = summary;
+		item.transaction_id = state->transaction_id;
+		priv->stream_callback (state->client,
+				       PK_CLIENT_STREAM_TYPE_PACKAGE,
+				       &item,
+				       priv->stream_user_data);
+	} else if (state->results != NULL && info_enum != PK_INFO_ENUM_FINISHED) {
+		pk_results_add_package_data (state->results, info_enum,
+					     package_id, summary,
+					     state->transaction_id);
+	}
 
 	/* only emit progress for verb packages */
 	switch (info_enum) {
@@ -779,6 +960,18 @@ pk_client_signal_package (PkClientState *state,
 	case PK_INFO_ENUM_PREPARING:
 	case PK_INFO_ENUM_DECOMPRESSING:
 	case PK_INFO_ENUM_FINISHED:
+		/* create virtual package */
+		package = pk_package_new ();
+		if (!pk_package_set_id (package, package_id, &error)) {
+			g_warning ("failed to set package id for %s", package_id);
+			return;
+		}
+		g_object_set (package,
+			      "info", info_enum,
+			      "summary", summary,
+			      "role", state->role,
+			      "transaction-id", state->transaction_id,
+			      NULL);
 		ret = pk_progress_set_package_id (state->progress, package_id);
 		if (state->progress_callback != NULL && ret) {
 			state->progress_callback (state->progress,
@@ -1037,6 +1230,102 @@ pk_client_signal_finished (PkClientState *state,
 	pk_client_state_finish (state, NULL);
 }
 
+/*
+ * pk_client_signal_files:
+ */
+static void
+pk_client_signal_files (PkClientState *state,
+			const gchar *package_id,
+			gchar **files)
+{
+	PkClientPrivate *priv = state->client->priv;
+	g_autoptr(PkFiles) item = NULL;
+
+	if (state->stream && priv->stream_callback != NULL) {
+		PkClientStreamItem stream_item = { 0 };
+		stream_item.package_id = package_id;
+		stream_item.files = (const gchar * const *) files;
+		stream_item.transaction_id = state->transaction_id;
+		priv->stream_callback (state->client,
+				       PK_CLIENT_STREAM_TYPE_FILES,
+				       &stream_item,
+				       priv->stream_user_data);
+		return;
+	}
+	item = pk_files_new ();
+	g_object_set (item,
+		      "package-id", package_id,
+		      "files", files,
+		      "role", state->role,
+		      "transaction-id", state->transaction_id,
+		      NULL);
+	pk_results_add_files (state->results, item);
+}
+
+/*
+ * pk_client_bulk_results_load:
+ *
+ * Maps the memfd sent in the BulkResults signal and handles its contents
+ * as if they had arrived as Package and Files signals.
+ **/
+static gboolean
+pk_client_bulk_results_load (PkClientState *state, gint fd, GError **error)
+{
+	const gchar *package_id;
+	const gchar *summary;
+	gchar **files;
+	guint info;
+	guint version;
+	GVariantIter iter;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GMappedFile) mapped_file = NULL;
+	g_autoptr(GVariant) packages = NULL;
+	g_autoptr(GVariant) files_array = NULL;
+	g_autoptr(GVariant) results = NULL;
+
+#ifdef F_GET_SEALS
+	/* the file must not be able to shrink or change under the mapping */
+	gint seals = fcntl (fd, F_GET_SEALS);
+	if (seals < 0 ||
+	    (seals & (F_SEAL_SHRINK | F_SEAL_WRITE)) != (F_SEAL_SHRINK | F_SEAL_WRITE)) {
+		g_set_error_literal (error,
+				     PK_CLIENT_ERROR,
+				     PK_CLIENT_ERROR_FAILED,
+				     "bulk results are not sealed");
+		return FALSE;
+	}
+#endif
+
+	mapped_file = g_mapped_file_new_from_fd (fd, FALSE, error);
+	if (mapped_file == NULL)
+		return FALSE;
+	bytes = g_mapped_file_get_bytes (mapped_file);
+	results = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (PK_BULK_RESULTS_FORMAT),
+								bytes,
+								FALSE));
+	g_variant_get_child (results, 0, "u", &version);
+	if (version != PK_BULK_RESULTS_VERSION) {
+		g_set_error (error,
+			     PK_CLIENT_ERROR,
+			     PK_CLIENT_ERROR_FAILED,
+			     "bulk results version %u not supported", version);
+		return FALSE;
+	}
+
+	packages = g_variant_get_child_value (results, 1);
+	g_variant_iter_init (&iter, packages);
+	while (g_variant_iter_next (&iter, "(u&s&s)", &info, &package_id, &summary))
+		pk_client_signal_package (state, info, package_id, summary);
+
+	files_array = g_variant_get_child_value (results, 2);
+	g_variant_iter_init (&iter, files_array);
+	while (g_variant_iter_next (&iter, "(&s^a&s)", &package_id, &files)) {
+		pk_client_signal_files (state, package_id, files);
+		g_free (files);
+	}
+	return TRUE;
+}
+
 /*
  * pk_client_signal_cb:
  **/
@@ -1078,6 +1367,35 @@ pk_client_signal_cb (GDBusProxy *proxy,
 					  tmp_str[2]);
 		return;
 	}
+	if (g_strcmp0 (signal_name, "Details") == 0 && state->stream &&
+	    state->client->priv->stream_callback != NULL) {
+		PkClientStreamItem item = { 0 };
+		item.transaction_id = state->transaction_id;
+		if (g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(a{sv})"))) {
+			g_autoptr(GVariant) dictionary = NULL;
+			dictionary = g_variant_get_child_value (parameters, 0);
+			g_variant_lookup (dictionary, "package-id", "&s", &item.package_id);
+			g_variant_lookup (dictionary, "license", "&s", &item.license);
+			g_variant_lookup (dictionary, "group", "u", &item.group);
+			g_variant_lookup (dictionary, "description", "&s", &item.description);
+			g_variant_lookup (dictionary, "url", "&s", &item.url);
+			g_variant_lookup (dictionary, "size", "t", &item.size);
+		} else {
+			g_variant_get (parameters,
+				       "(&s&su&s&st)",
+				       &item.package_id,
+				       &item.license,
+				       &item.group,
+				       &item.description,
+				       &item.url,
+				       &item.size);
+		}
+		state->client->priv->stream_callback (state->client,
+						      PK_CLIENT_STREAM_TYPE_DETAILS,
+						      &item,
+						      state->client->priv->stream_user_data);
+		return;
+	}
 	if (g_strcmp0 (signal_name, "Details") == 0) {
 		gchar *key;
 		GVariantIter *dictionary;
@@ -1247,19 +1565,24 @@ pk_client_signal_cb (GDBusProxy *proxy,
 	}
 	if (g_strcmp0 (signal_name, "Files") == 0) {
 		g_autofree gchar **files = NULL;
-		g_autoptr(PkFiles) item = NULL;
 		g_variant_get (parameters,
 			       "(&s^a&s)",
 			       &tmp_str[0],
 			       &files);
-		item = pk_files_new ();
-		g_object_set (item,
-			      "package-id", tmp_str[0],
-			      "files", files,
-			      "role", state->role,
-			      "transaction-id", state->transaction_id,
-			      NULL);
-		pk_results_add_files (state->results, item);
+		pk_client_signal_files (state, tmp_str[0], files);
+		return;
+	}
+	if (g_strcmp0 (signal_name, "BulkResults") == 0) {
+		g_autoptr(GError) error = NULL;
+		gint fd = pk_client_bulk_results_steal (state);
+		if (fd < 0) {
+			g_warning ("no fd received for the bulk results of %s",
+				   state->tid);
+			return;
+		}
+		if (!pk_client_bulk_results_load (state, fd, &error))
+			g_warning ("failed to load bulk results: %s", error->message);
+		close (fd);
 		return;
 	}
 	if (g_strcmp0 (signal_name, "RepoSignatureRequired") == 0) {
@@ -1992,6 +2315,38 @@ pk_client_create_helper_socket (PkClientState *state)
 	return g_strdup_printf ("frontend-socket=%s", socket_filename);
 }
 
+/*
+ * pk_client_state_use_stream:
+ *
+ * Only the query roles of a plain #PkClient are streamed, as #PkTask reads
+ * the results of its own simulate and query transactions back.
+ **/
+static gboolean
+pk_client_state_use_stream (PkClientState *state)
+{
+	if (state->client->priv->stream_callback == NULL)
+		return FALSE;
+	if (PK_IS_TASK (state->client))
+		return FALSE;
+	switch (state->role) {
+	case PK_ROLE_ENUM_DEPENDS_ON:
+	case PK_ROLE_ENUM_GET_DETAILS:
+	case PK_ROLE_ENUM_GET_FILES:
+	case PK_ROLE_ENUM_GET_PACKAGES:
+	case PK_ROLE_ENUM_GET_UPDATES:
+	case PK_ROLE_ENUM_REQUIRED_BY:
+	case PK_ROLE_ENUM_RESOLVE:
+	case PK_ROLE_ENUM_SEARCH_DETAILS:
+	case PK_ROLE_ENUM_SEARCH_FILE:
+	case PK_ROLE_ENUM_SEARCH_GROUP:
+	case PK_ROLE_ENUM_SEARCH_NAME:
+	case PK_ROLE_ENUM_WHAT_PROVIDES:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
 /*
  * pk_client_get_proxy_cb:
  **/
@@ -2012,6 +2367,9 @@ pk_client_get_proxy_cb (GObject *object,
 	/* connect */
 	pk_client_proxy_connect (state);
 
+	/* decide once per transaction what to stream */
+	state->stream = pk_client_state_use_stream (state);
+
 	/* get hints */
 	array = g_ptr_array_new_with_free_func (g_free);
 
@@ -2038,6 +2396,13 @@ pk_client_get_proxy_cb (GObject *object,
 		g_ptr_array_add (array, hint);
 	}
 
+	/* bulk-results */
+	if (state->client->priv->bulk_results &&
+	    pk_client_bulk_results_watch (state)) {
+		hint = g_strdup ("bulk-results=true");
+		g_ptr_array_add (array, hint);
+	}
+
 	/* create socket for roles that need interaction */
 	if (state->role == PK_ROLE_ENUM_INSTALL_FILES ||
 	    state->role == PK_ROLE_ENUM_INSTALL_PACKAGES ||
@@ -4406,6 +4771,9 @@ pk_client_adopt_get_proxy_cb (GObject *object,
 		return;
 	}
 
+	/* the caller may have asked for the results in bulk */
+	pk_client_bulk_results_watch (state);
+
 	/* connect */
 	pk_client_proxy_connect (state);
 }
@@ -4845,6 +5213,92 @@ pk_client_get_cache_age (PkClient *client)
 	return client->priv->cache_age;
 }
 
+/**
+ * pk_client_set_stream_callback:
+ * @client: a valid #PkClient instance
+ * @callback: (nullable) (scope notified): the function to call for each item, or %NULL
+ * @user_data: data to pass to @callback
+ * @destroy_func: (nullable): function to free @user_data
+ *
+ * Sets a callback that is called for each package, file list and details
+ * item as it is received. In this mode these items are not stored in the
+ * #PkResults returned when the transaction finishes and no #PkPackage,
+ * #PkFiles or #PkDetails objects are created, so very large result sets
+ * can be processed in constant memory.
+ *
+ * The strings in the #PkClientStreamItem are borrowed and must be copied
+ * if needed after the callback returns.
+ *
+ * Only query transactions such as resolving, searching or getting
+ * packages, details and files are streamed, and only when they are
+ * started after the callback was set. The items of all other
+ * transactions, and of any transaction started by a #PkTask, are stored
+ * in the #PkResults as usual.
+ *
+ * Since: 1.1.10
+ **/
+void
+pk_client_set_stream_callback (PkClient *client,
+			       PkClientStreamCallback callback,
+			       gpointer user_data,
+			       GDestroyNotify destroy_func)
+{
+	PkClientPrivate *priv;
+
+	g_return_if_fail (PK_IS_CLIENT (client));
+
+	priv = client->priv;
+	if (priv->stream_destroy_func != NULL)
+		priv->stream_destroy_func (priv->stream_user_data);
+	priv->stream_callback = callback;
+	priv->stream_user_data = user_data;
+	priv->stream_destroy_func = destroy_func;
+}
+
+/**
+ * pk_client_set_bulk_results:
+ * @client: a valid #PkClient instance
+ * @bulk_results: the value to set
+ *
+ * Sets whether the packages and file lists of queries should be sent by the
+ * daemon all at once in a memory mapped file rather than as one D-Bus signal
+ * each, which is a lot faster for very large result sets.
+ * The items still end up in the #PkResults or the stream callback as usual.
+ *
+ * Transactions adopted with pk_client_adopt_async() pick up bulk results
+ * whatever this is set to. Monitoring clients built against older versions
+ * of this library see no packages or files for transactions that asked
+ * for bulk results.
+ *
+ * This should be set before starting a transaction.
+ *
+ * Since: 1.1.10
+ **/
+void
+pk_client_set_bulk_results (PkClient *client, gboolean bulk_results)
+{
+	g_return_if_fail (PK_IS_CLIENT (client));
+	client->priv->bulk_results = bulk_results;
+	g_object_notify (G_OBJECT (client), "bulk-results");
+}
+
+/**
+ * pk_client_get_bulk_results:
+ * @client: a valid #PkClient instance
+ *
+ * Gets whether query results are sent in bulk.
+ *
+ * Return value: %TRUE if the results are sent in bulk
+ *
+ * Since: 1.1.10
+ **/
+gboolean
+pk_client_get_bulk_results (PkClient *client)
+{
+	g_return_val_if_fail (PK_IS_CLIENT (client), FALSE);
+	return client->priv->bulk_results;
+}
+
 /*
  * pk_client_class_init:
  **/
@@ -4908,6 +5362,16 @@ pk_client_class_init (PkClientClass *klass)
 				   0, G_MAXUINT, 0,
 				   G_PARAM_READWRITE);
 	g_object_class_install_property (object_class, PROP_CACHE_AGE, pspec);
+
+	/**
+	 * PkClient:bulk-results:
+	 *
+	 * Since: 1.1.10
+	 */
+	pspec = g_param_spec_boolean ("bulk-results", NULL, NULL,
+				      FALSE,
+				      G_PARAM_READWRITE);
+	g_object_class_install_property (object_class, PROP_BULK_RESULTS, pspec);
 }
 
 /*
@@ -4942,6 +5406,12 @@ pk_client_finalize (GObject *object)
 	/* ensure we cancel any in-flight DBus calls */
 	pk_client_cancel_all_dbus_methods (client);
 
+	if (priv->stream_destroy_func != NULL)
+		priv->stream_destroy_func (priv->stream_user_data);
+	if (priv->bulk_filter_id > 0)
+		g_dbus_connection_remove_filter (priv->connection, priv->bulk_filter_id);
+	if (priv->connection != NULL)
+		g_object_unref (priv->connection);
 	g_free (client->priv->locale);
 	g_object_unref (priv->control);
 	g_ptr_array_unref (priv->calls);
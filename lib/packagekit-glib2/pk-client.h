@@ -77,6 +77,56 @@ typedef enum
 	PK_CLIENT_ERROR_LAST
 } PkClientError;
 
+/**
+ * PkClientStreamType:
+ * @PK_CLIENT_STREAM_TYPE_PACKAGE: a package was emitted
+ * @PK_CLIENT_STREAM_TYPE_FILES: a file list was emitted
+ * @PK_CLIENT_STREAM_TYPE_DETAILS: package details were emitted
+ * @PK_CLIENT_STREAM_TYPE_LAST:
+ *
+ * The type of item passed to a #PkClientStreamCallback.
+ */
+typedef enum
+{
+	PK_CLIENT_STREAM_TYPE_PACKAGE,
+	PK_CLIENT_STREAM_TYPE_FILES,
+	PK_CLIENT_STREAM_TYPE_DETAILS,
+	PK_CLIENT_STREAM_TYPE_LAST
+} PkClientStreamType;
+
+/**
+ * PkClientStreamItem:
+ * @info: the #PkInfoEnum, for packages
+ * @package_id: the package ID
+ * @summary: the summary, for packages
+ * @files: the file list, for files
+ * @license: the license, for details
+ * @group: the #PkGroupEnum, for details
+ * @description: the description, for details
+ * @url: the upstream URL, for details
+ * @size: the package size, for details
+ * @transaction_id: the transaction that emitted the item
+ *
+ * The data for a streamed item. All the strings are borrowed from the
+ * D-Bus message and are only valid for the duration of the callback.
+ * Fields that do not apply to the #PkClientStreamType are unset.
+ *
+ * As the callback is set for the whole #PkClient, @transaction_id can be
+ * used to tell apart the items of transactions that run at the same time.
+ */
+typedef struct {
+	PkInfoEnum		 info;
+	const gchar		*package_id;
+	const gchar		*summary;
+	const gchar * const	*files;
+	const gchar		*license;
+	PkGroupEnum		 group;
+	const gchar		*description;
+	const gchar		*url;
+	guint64			 size;
+	const gchar		*transaction_id;
+} PkClientStreamItem;
+
 typedef struct _PkClientPrivate		PkClientPrivate;
 typedef struct _PkClient		PkClient;
 typedef struct _PkClientClass		PkClientClass;
@@ -105,6 +155,20 @@ struct _PkClientClass
 	void (*_pk_reserved5) (void);
 };
 
+/**
+ * PkClientStreamCallback:
+ * @client: a #PkClient
+ * @type: the type of item
+ * @item: the borrowed item data
+ * @user_data: User data supplied when the callback was registered.
+ *
+ * Function that is called for each streamed item.
+ */
+typedef void	(*PkClientStreamCallback)		(PkClient		*client,
+							 PkClientStreamType	 type,
+							 const PkClientStreamItem *item,
+							 gpointer		 user_data);
+
 GQuark		 pk_client_error_quark			(void);
 GType		 pk_client_get_type		  	(void);
 PkClient	*pk_client_new				(void);
@@ -426,6 +490,13 @@ gboolean	 pk_client_get_idle			(PkClient		*client);
 void		 pk_client_set_cache_age		(PkClient		*client,
 							 guint			 cache_age);
 guint		 pk_client_get_cache_age		(PkClient		*client);
+void		 pk_client_set_bulk_results		(PkClient		*client,
+							 gboolean		 bulk_results);
+gboolean	 pk_client_get_bulk_results		(PkClient		*client);
+void		 pk_client_set_stream_callback		(PkClient		*client,
+							 PkClientStreamCallback	 callback,
+							 gpointer		 user_data,
+							 GDestroyNotify		 destroy_func);
 
 G_END_DECLS
 
@@ -0,0 +1,379 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The PackageKit Authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * The index is a single file that can be mapped and searched without any
+ * parsing. All integers are little endian:
+ *
+ *   header:  "PKCNF01\0", guint32 n_entries, guint32 strings_offset
+ *   entries: n_entries * { guint32 command, guint32 package_id }
+ *   strings: NUL-terminated strings, referenced by offset
+ *
+ * The entries are sorted by command name so that lookups are a binary
+ * search, and a command provided by several packages has adjacent entries.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+#include <string.h>
+
+#include "pk-cnf-index-private.h"
+
+#define PK_CNF_INDEX_MAGIC	"PKCNF01"
+
+typedef struct {
+	gchar		 magic[8];
+	guint32		 n_entries;
+	guint32		 strings_offset;
+} PkCnfIndexHeader;
+
+typedef struct {
+	guint32		 command;
+	guint32		 package_id;
+} PkCnfIndexEntry;
+
+typedef struct {
+	const gchar	*command;
+	const gchar	*package_id;
+} PkCnfIndexItem;
+
+struct _PkCnfIndexBuilder {
+	GStringChunk	*strings;
+	GArray		*items;
+};
+
+struct _PkCnfIndex {
+	GMappedFile	*mapped;
+	const PkCnfIndexEntry *entries;
+	guint32		 n_entries;
+	const gchar	*strings;
+	gsize		 strings_len;
+};
+
+/* only these directories are searched by the shell for commands */
+static const gchar *pk_cnf_index_dirs[] = {
+	"/usr/bin/",
+	"/usr/sbin/",
+	"/bin/",
+	"/sbin/",
+	NULL };
+
+/**
+ * pk_cnf_index_builder_new:
+ *
+ * Return value: a new #PkCnfIndexBuilder
+ **/
+PkCnfIndexBuilder *
+pk_cnf_index_builder_new (void)
+{
+	PkCnfIndexBuilder *builder = g_new0 (PkCnfIndexBuilder, 1);
+	builder->strings = g_string_chunk_new (64 * 1024);
+	builder->items = g_array_new (FALSE, FALSE, sizeof (PkCnfIndexItem));
+	return builder;
+}
+
+/**
+ * pk_cnf_index_builder_free:
+ **/
+void
+pk_cnf_index_builder_free (PkCnfIndexBuilder *builder)
+{
+	if (builder == NULL)
+		return;
+	g_string_chunk_free (builder->strings);
+	g_array_unref (builder->items);
+	g_free (builder);
+}
+
+/**
+ * pk_cnf_index_builder_add_files:
+ * @builder: a #PkCnfIndexBuilder
+ * @package_id: the package that provides @files
+ * @files: the file list of the package
+ *
+ * Adds any executables in @files to the index.
+ **/
+void
+pk_cnf_index_builder_add_files (PkCnfIndexBuilder *builder,
+				const gchar *package_id,
+				gchar **files)
+{
+	const gchar *package_id_tmp = NULL;
+	guint i;
+	guint j;
+
+	g_return_if_fail (builder != NULL);
+	g_return_if_fail (package_id != NULL);
+
+	if (files == NULL)
+		return;
+	for (i = 0; files[i] != NULL; i++) {
+		for (j = 0; pk_cnf_index_dirs[j] != NULL; j++) {
+			PkCnfIndexItem item;
+			const gchar *command;
+
+			if (!g_str_has_prefix (files[i], pk_cnf_index_dirs[j]))
+				continue;
+			command = files[i] + strlen (pk_cnf_index_dirs[j]);
+			if (command[0] == '\0' || strchr (command, '/') != NULL)
+				break;
+			if (package_id_tmp == NULL) {
+				package_id_tmp = g_string_chunk_insert_const (builder->strings,
+									      package_id);
+			}
+			item.command = g_string_chunk_insert_const (builder->strings, command);
+			item.package_id = package_id_tmp;
+			g_array_append_val (builder->items, item);
+			break;
+		}
+	}
+}
+
+/**
+ * pk_cnf_index_builder_get_size:
+ *
+ * Return value: the number of executables added, including duplicates
+ **/
+guint
+pk_cnf_index_builder_get_size (PkCnfIndexBuilder *builder)
+{
+	g_return_val_if_fail (builder != NULL, 0);
+	return builder->items->len;
+}
+
+/**
+ * pk_cnf_index_item_sort_cb:
+ **/
+static gint
+pk_cnf_index_item_sort_cb (gconstpointer a, gconstpointer b)
+{
+	const PkCnfIndexItem *item_a = a;
+	const PkCnfIndexItem *item_b = b;
+	gint rc;
+
+	rc = g_strcmp0 (item_a->command, item_b->command);
+	if (rc != 0)
+		return rc;
+	return g_strcmp0 (item_a->package_id, item_b->package_id);
+}
+
+/**
+ * pk_cnf_index_builder_add_string:
+ **/
+static guint32
+pk_cnf_index_builder_add_string (GHashTable *offsets, GString *strings, const gchar *str)
+{
+	gpointer offset;
+
+	/* the strings are interned, so the pointer is a unique key */
+	if (g_hash_table_lookup_extended (offsets, str, NULL, &offset))
+		return GPOINTER_TO_UINT (offset);
+	offset = GUINT_TO_POINTER (strings->len);
+	g_string_append_len (strings, str, strlen (str) + 1);
+	g_hash_table_insert (offsets, (gpointer) str, offset);
+	return GPOINTER_TO_UINT (offset);
+}
+
+/**
+ * pk_cnf_index_builder_save:
+ * @builder: a #PkCnfIndexBuilder
+ * @filename: the index file to write
+ * @error: A #GError or %NULL
+ *
+ * Writes the index. The file is replaced atomically so that readers
+ * never see a partially written index.
+ *
+ * Return value: %TRUE for success, else %FALSE and @error set
+ **/
+gboolean
+pk_cnf_index_builder_save (PkCnfIndexBuilder *builder,
+			   const gchar *filename,
+			   GError **error)
+{
+	PkCnfIndexHeader header;
+	PkCnfIndexItem *item;
+	PkCnfIndexItem *last = NULL;
+	guint i;
+	g_autoptr(GArray) entries = NULL;
+	g_autoptr(GHashTable) offsets = NULL;
+	g_autoptr(GString) data = NULL;
+	g_autoptr(GString) strings = NULL;
+
+	g_return_val_if_fail (builder != NULL, FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	/* sort and remove duplicates */
+	g_array_sort (builder->items, pk_cnf_index_item_sort_cb);
+	entries = g_array_new (FALSE, FALSE, sizeof (PkCnfIndexEntry));
+	offsets = g_hash_table_new (g_direct_hash, g_direct_equal);
+	strings = g_string_new (NULL);
+	for (i = 0; i < builder->items->len; i++) {
+		PkCnfIndexEntry entry;
+		item = &g_array_index (builder->items, PkCnfIndexItem, i);
+		if (last != NULL && pk_cnf_index_item_sort_cb (last, item) == 0)
+			continue;
+		entry.command = GUINT32_TO_LE (pk_cnf_index_builder_add_string (offsets, strings, item->command));
+		entry.package_id = GUINT32_TO_LE (pk_cnf_index_builder_add_string (offsets, strings, item->package_id));
+		g_array_append_val (entries, entry);
+		last = item;
+	}
+
+	/* assemble the file */
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, PK_CNF_INDEX_MAGIC, sizeof (PK_CNF_INDEX_MAGIC));
+	header.n_entries = GUINT32_TO_LE (entries->len);
+	header.strings_offset = GUINT32_TO_LE (sizeof (header) +
+					       entries->len * sizeof (PkCnfIndexEntry));
+	data = g_string_sized_new (sizeof (header) +
+				   entries->len * sizeof (PkCnfIndexEntry) +
+				   strings->len);
+	g_string_append_len (data, (const gchar *) &header, sizeof (header));
+	g_string_append_len (data, (const gchar *) entries->data,
+			     entries->len * sizeof (PkCnfIndexEntry));
+	g_string_append_len (data, strings->str, strings->len);
+	g_debug ("writing %u commands to %s", entries->len, filename);
+	return g_file_set_contents (filename, data->str, data->len, error);
+}
+
+/**
+ * pk_cnf_index_new_from_file:
+ * @filename: the index file to map
+ * @error: A #GError or %NULL
+ *
+ * Maps an index written by pk_cnf_index_builder_save().
+ *
+ * Return value: a new #PkCnfIndex, or %NULL if the file is missing or invalid
+ **/
+PkCnfIndex *
+pk_cnf_index_new_from_file (const gchar *filename, GError **error)
+{
+	const gchar *data;
+	const PkCnfIndexHeader *header;
+	gsize len;
+	guint32 n_entries;
+	guint32 strings_offset;
+	g_autoptr(GMappedFile) mapped = NULL;
+	PkCnfIndex *index;
+
+	g_return_val_if_fail (filename != NULL, NULL);
+
+	mapped = g_mapped_file_new (filename, FALSE, error);
+	if (mapped == NULL)
+		return NULL;
+
+	/* check the header */
+	data = g_mapped_file_get_contents (mapped);
+	len = g_mapped_file_get_length (mapped);
+	if (len < sizeof (PkCnfIndexHeader) ||
+	    memcmp (data, PK_CNF_INDEX_MAGIC, sizeof (PK_CNF_INDEX_MAGIC)) != 0) {
+		g_set_error (error, 1, 0, "%s is not a command index", filename);
+		return NULL;
+	}
+	header = (const PkCnfIndexHeader *) data;
+	n_entries = GUINT32_FROM_LE (header->n_entries);
+	strings_offset = GUINT32_FROM_LE (header->strings_offset);
+	if ((guint64) n_entries * sizeof (PkCnfIndexEntry) + sizeof (PkCnfIndexHeader) != strings_offset ||
+	    strings_offset > len ||
+	    (len > strings_offset && data[len - 1] != '\0')) {
+		g_set_error (error, 1, 0, "%s is truncated", filename);
+		return NULL;
+	}
+
+	index = g_new0 (PkCnfIndex, 1);
+	index->mapped = g_steal_pointer (&mapped);
+	index->entries = (const PkCnfIndexEntry *) (data + sizeof (PkCnfIndexHeader));
+	index->n_entries = n_entries;
+	index->strings = data + strings_offset;
+	index->strings_len = len - strings_offset;
+	return index;
+}
+
+/**
+ * pk_cnf_index_free:
+ **/
+void
+pk_cnf_index_free (PkCnfIndex *index)
+{
+	if (index == NULL)
+		return;
+	g_mapped_file_unref (index->mapped);
+	g_free (index);
+}
+
+/**
+ * pk_cnf_index_get_string:
+ **/
+static const gchar *
+pk_cnf_index_get_string (PkCnfIndex *index, guint32 offset)
+{
+	offset = GUINT32_FROM_LE (offset);
+	if (offset >= index->strings_len)
+		return NULL;
+	return index->strings + offset;
+}
+
+/**
+ * pk_cnf_index_lookup:
+ * @index: a #PkCnfIndex
+ * @command: the command name, e.g. "powertop"
+ *
+ * Finds the packages that provide an executable called @command.
+ *
+ * Return value: (transfer full): the package IDs, which may be empty
+ **/
+gchar **
+pk_cnf_index_lookup (PkCnfIndex *index, const gchar *command)
+{
+	guint32 low = 0;
+	guint32 high;
+	g_autoptr(GPtrArray) package_ids = NULL;
+
+	g_return_val_if_fail (index != NULL, NULL);
+	g_return_val_if_fail (command != NULL, NULL);
+
+	/* find the first entry that is not less than the command */
+	high = index->n_entries;
+	while (low < high) {
+		guint32 mid = low + (high - low) / 2;
+		const gchar *tmp = pk_cnf_index_get_string (index, index->entries[mid].command);
+		if (g_strcmp0 (tmp, command) < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	/* return all the packages for this command */
+	package_ids = g_ptr_array_new ();
+	for (; low < index->n_entries; low++) {
+		const gchar *tmp;
+		tmp = pk_cnf_index_get_string (index, index->entries[low].command);
+		if (g_strcmp0 (tmp, command) != 0)
+			break;
+		tmp = pk_cnf_index_get_string (index, index->entries[low].package_id);
+		if (tmp != NULL)
+			g_ptr_array_add (package_ids, g_strdup (tmp));
+	}
+	g_ptr_array_add (package_ids, NULL);
+	return (gchar **) g_ptr_array_free (g_steal_pointer (&package_ids), FALSE);
+}
@@ -0,0 +1,65 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The PackageKit Authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#if !defined (__PACKAGEKIT_H_INSIDE__) && !defined (PK_COMPILATION)
+#error "Only <packagekit.h> can be included directly."
+#endif
+
+#ifndef __PK_CNF_INDEX_PRIVATE_H
+#define __PK_CNF_INDEX_PRIVATE_H
+
+/* these are shared between the daemon, which writes the index, and
+ * pk-command-not-found in contrib, which reads it */
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* the index of executables provided by available packages */
+#define PK_CNF_INDEX_FILENAME		"/var/lib/PackageKit/command-not-found.idx"
+
+typedef struct _PkCnfIndex		PkCnfIndex;
+typedef struct _PkCnfIndexBuilder	PkCnfIndexBuilder;
+
+PkCnfIndexBuilder	*pk_cnf_index_builder_new	(void);
+void			 pk_cnf_index_builder_free	(PkCnfIndexBuilder	*builder);
+void			 pk_cnf_index_builder_add_files	(PkCnfIndexBuilder	*builder,
+							 const gchar		*package_id,
+							 gchar			**files);
+guint			 pk_cnf_index_builder_get_size	(PkCnfIndexBuilder	*builder);
+gboolean		 pk_cnf_index_builder_save	(PkCnfIndexBuilder	*builder,
+							 const gchar		*filename,
+							 GError			**error);
+
+PkCnfIndex		*pk_cnf_index_new_from_file	(const gchar		*filename,
+							 GError			**error);
+void			 pk_cnf_index_free		(PkCnfIndex		*index);
+gchar			**pk_cnf_index_lookup		(PkCnfIndex		*index,
+							 const gchar		*command);
+
+#ifdef G_DEFINE_AUTOPTR_CLEANUP_FUNC
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(PkCnfIndexBuilder, pk_cnf_index_builder_free)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(PkCnfIndex, pk_cnf_index_free)
+#endif
+
+G_END_DECLS
+
+#endif /* __PK_CNF_INDEX_PRIVATE_H */
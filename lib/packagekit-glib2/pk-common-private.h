@@ -30,6 +30,10 @@
 
 G_BEGIN_DECLS
 
+/* the serialized contents of the memfd sent in the BulkResults signal */
+#define PK_BULK_RESULTS_FORMAT		"(ua(uss)a(sas))"
+#define PK_BULK_RESULTS_VERSION		1
+
 gchar		*pk_get_distro_name			(GError		**error);
 gchar		*pk_get_distro_version_id		(GError		**error);
 
@@ -0,0 +1,86 @@
+#!/usr/bin/python
+#
+# This generates perfect hash tables for the PkEnumMatch tables in pk-enum.c
+# so that the string to enum and enum to string conversions do not have to
+# scan the whole table. The output is included by pk-enum.c itself.
+
+from __future__ import print_function
+
+from re import compile, DOTALL, MULTILINE
+import sys
+
+enum = compile(r"static const PkEnumMatch enum_([a-z_]+)\[\] = {(.*?)};", DOTALL | MULTILINE)
+value = compile(r"{\s*(PK_[A-Z0-9_]+),\s*\"([^\"]+)\"\s*}")
+
+FNV_BASIS = 2166136261
+FNV_PRIME = 16777619
+
+def _hash(string, seed):
+    ''' must match pk_enum_hash_string() in pk-enum.c '''
+    h = (FNV_BASIS ^ seed) & 0xffffffff
+    for b in bytearray(string.encode('utf-8')):
+        h ^= b
+        h = (h * FNV_PRIME) & 0xffffffff
+    return h
+
+def _find_seed(strings):
+    ''' find the smallest power-of-two table and seed without collisions '''
+    size = 1
+    while size < len(strings) * 2:
+        size *= 2
+    while True:
+        for seed in range(0, 100000):
+            slots = set()
+            for string in strings:
+                slot = _hash(string, seed) & (size - 1)
+                if slot in slots:
+                    break
+                slots.add(slot)
+            else:
+                return (size, seed)
+        size *= 2
+
+def _format_array(values):
+    lines = []
+    for i in range(0, len(values), 16):
+        lines.append('\t' + ', '.join(['%i' % v for v in values[i:i + 16]]) + ',')
+    return '\n'.join(lines)
+
+inp = open(sys.argv[1]).read()
+
+print("/* This file was autogenerated from %s by pk-enum-hash.py */\n" % sys.argv[1])
+for (name, data) in enum.findall(inp):
+    entries = value.findall(data)
+    if len(entries) >= 255:
+        sys.exit("enum_%s has too many entries" % name)
+
+    # like the linear scan, the first match wins for duplicates
+    strings = []
+    indexes = {}
+    for (idx, (constant, string)) in enumerate(entries):
+        if string in indexes:
+            continue
+        indexes[string] = idx
+        strings.append(string)
+    (size, seed) = _find_seed(strings)
+    slots = [0] * size
+    for string in strings:
+        slots[_hash(string, seed) & (size - 1)] = indexes[string] + 1
+
+    print("static const guint8 enum_%s_slots[%i] = {" % (name, size))
+    print(_format_array(slots))
+    print("};\n")
+
+    print("static const guint8 enum_%s_index[] = {" % name)
+    seen = set()
+    for (idx, (constant, string)) in enumerate(entries):
+        if constant in seen:
+            continue
+        seen.add(constant)
+        print("\t[%s] = %i," % (constant, idx + 1))
+    print("};\n")
+
+    print("static const PkEnumHash enum_%s_hash = {" % name)
+    print("\tenum_%s, enum_%s_slots, %i, 0x%08xu," % (name, name, size - 1, seed))
+    print("\tenum_%s_index, G_N_ELEMENTS (enum_%s_index)" % (name, name))
+    print("};\n")
@@ -382,6 +382,77 @@ static const PkEnumMatch enum_transaction_flag[] = {
 	{0, NULL}
 };
 
+/**
+ * PkEnumHash:
+ *
+ * A perfect hash over one of the tables above, generated at build time.
+ * Both the slots and the index store the table offset plus one, so that
+ * zero means not present.
+ **/
+typedef struct {
+	const PkEnumMatch	*table;
+	const guint8		*slots;
+	guint32			 mask;
+	guint32			 seed;
+	const guint8		*index;
+	guint			 index_len;
+} PkEnumHash;
+
+#include "pk-enum-hash.h"
+
+/**
+ * pk_enum_hash_string:
+ *
+ * FNV-1a, which has to match _hash() in pk-enum-hash.py
+ **/
+static inline guint32
+pk_enum_hash_string (const gchar *string, guint32 seed)
+{
+	const guchar *tmp;
+	guint32 h = 2166136261u ^ seed;
+	for (tmp = (const guchar *) string; *tmp != '\0'; tmp++) {
+		h ^= *tmp;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/**
+ * pk_enum_hash_find_value:
+ *
+ * Like pk_enum_find_value() but with a single probe.
+ **/
+static guint
+pk_enum_hash_find_value (const PkEnumHash *hash, const gchar *string)
+{
+	guint8 idx;
+
+	/* return the first entry on non-found or error */
+	if (string == NULL)
+		return hash->table[0].value;
+	idx = hash->slots[pk_enum_hash_string (string, hash->seed) & hash->mask];
+	if (idx == 0 || strcmp (string, hash->table[idx - 1].string) != 0)
+		return hash->table[0].value;
+	return hash->table[idx - 1].value;
+}
+
+/**
+ * pk_enum_hash_find_string:
+ *
+ * Like pk_enum_find_string() but with a direct index.
+ **/
+static const gchar *
+pk_enum_hash_find_string (const PkEnumHash *hash, guint value)
+{
+	guint8 idx;
+	if (value >= hash->index_len)
+		return hash->table[0].string;
+	idx = hash->index[value];
+	if (idx == 0)
+		return hash->table[0].string;
+	return hash->table[idx - 1].string;
+}
+
 /**
  * pk_enum_find_value:
  * @table: A #PkEnumMatch enum table of values
@@ -450,7 +521,7 @@ pk_enum_find_string (const PkEnumMatch *table, guint value)
 PkSigTypeEnum
 pk_sig_type_enum_from_string (const gchar *sig_type)
 {
-	return pk_enum_find_value (enum_sig_type, sig_type);
+	return pk_enum_hash_find_value (&enum_sig_type_hash, sig_type);
 }
 
 /**
@@ -466,7 +537,7 @@ pk_sig_type_enum_from_string (const gchar *sig_type)
 const gchar *
 pk_sig_type_enum_to_string (PkSigTypeEnum sig_type)
 {
-	return pk_enum_find_string (enum_sig_type, sig_type);
+	return pk_enum_hash_find_string (&enum_sig_type_hash, sig_type);
 }
 
 /**
@@ -482,7 +553,7 @@ pk_sig_type_enum_to_string (PkSigTypeEnum sig_type)
 PkDistroUpgradeEnum
 pk_distro_upgrade_enum_from_string (const gchar *upgrade)
 {
-	return pk_enum_find_value (enum_upgrade, upgrade);
+	return pk_enum_hash_find_value (&enum_upgrade_hash, upgrade);
 }
 
 /**
@@ -498,7 +569,7 @@ pk_distro_upgrade_enum_from_string (const gchar *upgrade)
 const gchar *
 pk_distro_upgrade_enum_to_string (PkDistroUpgradeEnum upgrade)
 {
-	return pk_enum_find_string (enum_upgrade, upgrade);
+	return pk_enum_hash_find_string (&enum_upgrade_hash, upgrade);
 }
 
 /**
@@ -514,7 +585,7 @@ pk_distro_upgrade_enum_to_string (PkDistroUpgradeEnum upgrade)
 PkInfoEnum
 pk_info_enum_from_string (const gchar *info)
 {
-	return pk_enum_find_value (enum_info, info);
+	return pk_enum_hash_find_value (&enum_info_hash, info);
 }
 
 /**
@@ -530,7 +601,7 @@ pk_info_enum_from_string (const gchar *info)
 const gchar *
 pk_info_enum_to_string (PkInfoEnum info)
 {
-	return pk_enum_find_string (enum_info, info);
+	return pk_enum_hash_find_string (&enum_info_hash, info);
 }
 
 /**
@@ -546,7 +617,7 @@ pk_info_enum_to_string (PkInfoEnum info)
 PkExitEnum
 pk_exit_enum_from_string (const gchar *exit_text)
 {
-	return pk_enum_find_value (enum_exit, exit_text);
+	return pk_enum_hash_find_value (&enum_exit_hash, exit_text);
 }
 
 /**
@@ -562,7 +633,7 @@ pk_exit_enum_from_string (const gchar *exit_text)
 const gchar *
 pk_exit_enum_to_string (PkExitEnum exit_enum)
 {
-	return pk_enum_find_string (enum_exit, exit_enum);
+	return pk_enum_hash_find_string (&enum_exit_hash, exit_enum);
 }
 
 /**
@@ -578,7 +649,7 @@ pk_exit_enum_to_string (PkExitEnum exit_enum)
 PkNetworkEnum
 pk_network_enum_from_string (const gchar *network)
 {
-	return pk_enum_find_value (enum_network, network);
+	return pk_enum_hash_find_value (&enum_network_hash, network);
 }
 
 /**
@@ -594,7 +665,7 @@ pk_network_enum_from_string (const gchar *network)
 const gchar *
 pk_network_enum_to_string (PkNetworkEnum network)
 {
-	return pk_enum_find_string (enum_network, network);
+	return pk_enum_hash_find_string (&enum_network_hash, network);
 }
 
 /**
@@ -610,7 +681,7 @@ pk_network_enum_to_string (PkNetworkEnum network)
 PkStatusEnum
 pk_status_enum_from_string (const gchar *status)
 {
-	return pk_enum_find_value (enum_status, status);
+	return pk_enum_hash_find_value (&enum_status_hash, status);
 }
 
 /**
@@ -626,7 +697,7 @@ pk_status_enum_from_string (const gchar *status)
 const gchar *
 pk_status_enum_to_string (PkStatusEnum status)
 {
-	return pk_enum_find_string (enum_status, status);
+	return pk_enum_hash_find_string (&enum_status_hash, status);
 }
 
 /**
@@ -642,7 +713,7 @@ pk_status_enum_to_string (PkStatusEnum status)
 PkRoleEnum
 pk_role_enum_from_string (const gchar *role)
 {
-	return pk_enum_find_value (enum_role, role);
+	return pk_enum_hash_find_value (&enum_role_hash, role);
 }
 
 /**
@@ -658,7 +729,7 @@ pk_role_enum_from_string (const gchar *role)
 const gchar *
 pk_role_enum_to_string (PkRoleEnum role)
 {
-	return pk_enum_find_string (enum_role, role);
+	return pk_enum_hash_find_string (&enum_role_hash, role);
 }
 
 /**
@@ -674,7 +745,7 @@ pk_role_enum_to_string (PkRoleEnum role)
 PkErrorEnum
 pk_error_enum_from_string (const gchar *code)
 {
-	return pk_enum_find_value (enum_error, code);
+	return pk_enum_hash_find_value (&enum_error_hash, code);
 }
 
 /**
@@ -690,7 +761,7 @@ pk_error_enum_from_string (const gchar *code)
 const gchar *
 pk_error_enum_to_string (PkErrorEnum code)
 {
-	return pk_enum_find_string (enum_error, code);
+	return pk_enum_hash_find_string (&enum_error_hash, code);
 }
 
 /**
@@ -706,7 +777,7 @@ pk_error_enum_to_string (PkErrorEnum code)
 PkRestartEnum
 pk_restart_enum_from_string (const gchar *restart)
 {
-	return pk_enum_find_value (enum_restart, restart);
+	return pk_enum_hash_find_value (&enum_restart_hash, restart);
 }
 
 /**
@@ -722,7 +793,7 @@ pk_restart_enum_from_string (const gchar *restart)
 const gchar *
 pk_restart_enum_to_string (PkRestartEnum restart)
 {
-	return pk_enum_find_string (enum_restart, restart);
+	return pk_enum_hash_find_string (&enum_restart_hash, restart);
 }
 
 /**
@@ -738,7 +809,7 @@ pk_restart_enum_to_string (PkRestartEnum restart)
 PkGroupEnum
 pk_group_enum_from_string (const gchar *group)
 {
-	return pk_enum_find_value (enum_group, group);
+	return pk_enum_hash_find_value (&enum_group_hash, group);
 }
 
 /**
@@ -754,7 +825,7 @@ pk_group_enum_from_string (const gchar *group)
 const gchar *
 pk_group_enum_to_string (PkGroupEnum group)
 {
-	return pk_enum_find_string (enum_group, group);
+	return pk_enum_hash_find_string (&enum_group_hash, group);
 }
 
 /**
@@ -770,7 +841,7 @@ pk_group_enum_to_string (PkGroupEnum group)
 PkUpdateStateEnum
 pk_update_state_enum_from_string (const gchar *update_state)
 {
-	return pk_enum_find_value (enum_update_state, update_state);
+	return pk_enum_hash_find_value (&enum_update_state_hash, update_state);
 }
 
 /**
@@ -786,7 +857,7 @@ pk_update_state_enum_from_string (const gchar *update_state)
 const gchar *
 pk_update_state_enum_to_string (PkUpdateStateEnum update_state)
 {
-	return pk_enum_find_string (enum_update_state, update_state);
+	return pk_enum_hash_find_string (&enum_update_state_hash, update_state);
 }
 
 /**
@@ -802,7 +873,7 @@ pk_update_state_enum_to_string (PkUpdateStateEnum update_state)
 PkFilterEnum
 pk_filter_enum_from_string (const gchar *filter)
 {
-	return pk_enum_find_value (enum_filter, filter);
+	return pk_enum_hash_find_value (&enum_filter_hash, filter);
 }
 
 /**
@@ -818,7 +889,7 @@ pk_filter_enum_from_string (const gchar *filter)
 const gchar *
 pk_filter_enum_to_string (PkFilterEnum filter)
 {
-	return pk_enum_find_string (enum_filter, filter);
+	return pk_enum_hash_find_string (&enum_filter_hash, filter);
 }
 
 /**
@@ -834,7 +905,7 @@ pk_filter_enum_to_string (PkFilterEnum filter)
 PkMediaTypeEnum
 pk_media_type_enum_from_string (const gchar *media_type)
 {
-	return pk_enum_find_value (enum_media_type, media_type);
+	return pk_enum_hash_find_value (&enum_media_type_hash, media_type);
 }
 
 /**
@@ -850,7 +921,7 @@ pk_media_type_enum_from_string (const gchar *media_type)
 const gchar *
 pk_media_type_enum_to_string (PkMediaTypeEnum media_type)
 {
-	return pk_enum_find_string (enum_media_type, media_type);
+	return pk_enum_hash_find_string (&enum_media_type_hash, media_type);
 }
 
 /**
@@ -866,7 +937,7 @@ pk_media_type_enum_to_string (PkMediaTypeEnum media_type)
 PkAuthorizeEnum
 pk_authorize_type_enum_from_string (const gchar *authorize_type)
 {
-	return pk_enum_find_value (enum_authorize_type, authorize_type);
+	return pk_enum_hash_find_value (&enum_authorize_type_hash, authorize_type);
 }
 
 /**
@@ -882,7 +953,7 @@ pk_authorize_type_enum_from_string (const gchar *authorize_type)
 const gchar *
 pk_authorize_type_enum_to_string (PkAuthorizeEnum authorize_type)
 {
-	return pk_enum_find_string (enum_authorize_type, authorize_type);
+	return pk_enum_hash_find_string (&enum_authorize_type_hash, authorize_type);
 }
 
 /**
@@ -898,7 +969,7 @@ pk_authorize_type_enum_to_string (PkAuthorizeEnum authorize_type)
 PkUpgradeKindEnum
 pk_upgrade_kind_enum_from_string (const gchar *upgrade_kind)
 {
-	return pk_enum_find_value (enum_upgrade_kind, upgrade_kind);
+	return pk_enum_hash_find_value (&enum_upgrade_kind_hash, upgrade_kind);
 }
 
 /**
@@ -914,7 +985,7 @@ pk_upgrade_kind_enum_from_string (const gchar *upgrade_kind)
 const gchar *
 pk_upgrade_kind_enum_to_string (PkUpgradeKindEnum upgrade_kind)
 {
-	return pk_enum_find_string (enum_upgrade_kind, upgrade_kind);
+	return pk_enum_hash_find_string (&enum_upgrade_kind_hash, upgrade_kind);
 }
 
 /**
@@ -930,7 +1001,7 @@ pk_upgrade_kind_enum_to_string (PkUpgradeKindEnum upgrade_kind)
 PkTransactionFlagEnum
 pk_transaction_flag_enum_from_string (const gchar *transaction_flag)
 {
-	return pk_enum_find_value (enum_transaction_flag, transaction_flag);
+	return pk_enum_hash_find_value (&enum_transaction_flag_hash, transaction_flag);
 }
 
 /**
@@ -946,7 +1017,7 @@ pk_transaction_flag_enum_from_string (const gchar *transaction_flag)
 const gchar *
 pk_transaction_flag_enum_to_string (PkTransactionFlagEnum transaction_flag)
 {
-	return pk_enum_find_string (enum_transaction_flag, transaction_flag);
+	return pk_enum_hash_find_string (&enum_transaction_flag_hash, transaction_flag);
 }
 
 /**
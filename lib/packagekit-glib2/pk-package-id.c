@@ -76,23 +76,27 @@ out:
 gboolean
 pk_package_id_check (const gchar *package_id)
 {
-	g_auto(GStrv) sections = NULL;
-	gboolean ret;
+	const gchar *tmp;
+	guint delims = 0;
 
 	/* NULL check */
 	if (package_id == NULL)
 		return FALSE;
 
 	/* UTF8 */
-	ret = g_utf8_validate (package_id, -1, NULL);
-	if (!ret)
+	if (!g_utf8_validate (package_id, -1, NULL))
 		return FALSE;
 
-	/* correct number of sections */
-	sections = pk_package_id_split (package_id);
-	if (sections == NULL)
+	/* name has to be valid */
+	if (package_id[0] == ';' || package_id[0] == '\0')
 		return FALSE;
-	return TRUE;
+
+	/* correct number of sections, without splitting */
+	for (tmp = package_id; *tmp != '\0'; tmp++) {
+		if (*tmp == ';')
+			delims++;
+	}
+	return delims == 3;
 }
 
 /**
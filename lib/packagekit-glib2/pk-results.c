@@ -36,6 +36,7 @@
 #include <packagekit-glib2/pk-results.h>
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-enum-types.h>
+#include <packagekit-glib2/pk-package-id.h>
 
 static void     pk_results_finalize	(GObject     *object);
 
@@ -66,6 +67,12 @@ struct _PkResultsPrivate
 	GPtrArray		*media_change_required_array;
 	GPtrArray		*repo_detail_array;
 	PkPackageSack		*package_sack;
+	GPtrArray		*package_array;
+	GStringChunk		*package_strings;
+	GByteArray		*package_infos;
+	GPtrArray		*package_ids;
+	GPtrArray		*package_summaries;
+	GPtrArray		*package_tids;
 };
 
 enum {
@@ -181,6 +188,45 @@ pk_results_set_exit_code (PkResults *results, PkExitEnum exit_enum)
 	return TRUE;
 }
 
+/**
+ * pk_results_materialize_packages:
+ *
+ * Converts any compact package rows into real #PkPackage objects in the
+ * package sack, keeping the order they were added in.
+ **/
+static void
+pk_results_materialize_packages (PkResults *results)
+{
+	PkResultsPrivate *priv = results->priv;
+	guint i;
+
+	if (priv->package_ids->len == 0)
+		return;
+	for (i = 0; i < priv->package_ids->len; i++) {
+		g_autoptr(PkPackage) package = pk_package_new ();
+
+		/* the ID was checked when it was added */
+		pk_package_set_id (package,
+				   g_ptr_array_index (priv->package_ids, i),
+				   NULL);
+		g_object_set (package,
+			      "info", priv->package_infos->data[i],
+			      "summary", g_ptr_array_index (priv->package_summaries, i),
+			      "role", priv->role,
+			      "transaction-id", g_ptr_array_index (priv->package_tids, i),
+			      NULL);
+		pk_package_sack_add_package (priv->package_sack, package);
+	}
+	g_debug ("materialized %u packages", priv->package_ids->len);
+
+	/* the strings are now owned by the objects */
+	g_byte_array_set_size (priv->package_infos, 0);
+	g_ptr_array_set_size (priv->package_ids, 0);
+	g_ptr_array_set_size (priv->package_summaries, 0);
+	g_ptr_array_set_size (priv->package_tids, 0);
+	g_string_chunk_clear (priv->package_strings);
+}
+
 /**
  * pk_results_add_package:
  * @results: a valid #PkResults instance
@@ -203,10 +249,63 @@ pk_results_add_package (PkResults *results, PkPackage *item)
 		g_warning ("Finished packages cannot be added to PkResults");
 		return FALSE;
 	}
+	pk_results_materialize_packages (results);
 	pk_package_sack_add_package (results->priv->package_sack, item);
 	return TRUE;
 }
 
+/**
+ * pk_results_add_package_data:
+ * @results: a valid #PkResults instance
+ * @info: the #PkInfoEnum of the package
+ * @package_id: the package ID
+ * @summary: (nullable): the package summary
+ * @transaction_id: (nullable): the transaction that emitted the package
+ *
+ * Adds a package to the results set without creating a #PkPackage.
+ * The strings are copied into a compact store. The package is only turned
+ * into a #PkPackage if pk_results_get_package_array() or
+ * pk_results_get_package_sack() is called.
+ *
+ * Return value: %TRUE if the value was set, %FALSE if @package_id is invalid
+ *
+ * Since: 1.1.10
+ **/
+gboolean
+pk_results_add_package_data (PkResults *results,
+			     PkInfoEnum info,
+			     const gchar *package_id,
+			     const gchar *summary,
+			     const gchar *transaction_id)
+{
+	PkResultsPrivate *priv;
+	guint8 info_tmp = info;
+
+	g_return_val_if_fail (PK_IS_RESULTS (results), FALSE);
+	g_return_val_if_fail (package_id != NULL, FALSE);
+
+	/* do not allow finished types */
+	if (info == PK_INFO_ENUM_FINISHED) {
+		g_warning ("Finished packages cannot be added to PkResults");
+		return FALSE;
+	}
+
+	/* check now, so the count matches the objects created later */
+	if (!pk_package_id_check (package_id)) {
+		g_warning ("invalid package id %s", package_id);
+		return FALSE;
+	}
+	priv = results->priv;
+	g_byte_array_append (priv->package_infos, &info_tmp, 1);
+	g_ptr_array_add (priv->package_ids,
+			 g_string_chunk_insert_const (priv->package_strings, package_id));
+	g_ptr_array_add (priv->package_summaries,
+			 summary != NULL ? g_string_chunk_insert (priv->package_strings, summary) : NULL);
+	g_ptr_array_add (priv->package_tids,
+			 transaction_id != NULL ? g_string_chunk_insert_const (priv->package_strings, transaction_id) : NULL);
+	return TRUE;
+}
+
 /**
  * pk_results_add_details:
  * @results: a valid #PkResults instance
@@ -578,9 +677,138 @@ GPtrArray *
 pk_results_get_package_array (PkResults *results)
 {
 	g_return_val_if_fail (PK_IS_RESULTS (results), NULL);
+	pk_results_materialize_packages (results);
 	return pk_package_sack_get_array (results->priv->package_sack);
 }
 
+/**
+ * pk_results_get_package_count:
+ * @results: a valid #PkResults instance
+ *
+ * Gets the number of packages in the results, without creating any
+ * #PkPackage objects.
+ *
+ * Return value: the number of packages
+ *
+ * Since: 1.1.10
+ **/
+guint
+pk_results_get_package_count (PkResults *results)
+{
+	g_return_val_if_fail (PK_IS_RESULTS (results), 0);
+	return pk_package_sack_get_size (results->priv->package_sack) +
+		results->priv->package_ids->len;
+}
+
+/**
+ * pk_results_get_package_data:
+ * @results: a valid #PkResults instance
+ * @idx: the package index, less than pk_results_get_package_count()
+ * @info: (out) (optional): the #PkInfoEnum of the package
+ * @package_id: (out) (optional) (transfer none): the package ID
+ * @summary: (out) (optional) (transfer none): the package summary
+ *
+ * Gets the data for one package without creating a #PkPackage object.
+ * The strings are owned by @results and are only valid until the
+ * next call that adds or gets packages.
+ *
+ * Return value: %TRUE if @idx was valid
+ *
+ * Since: 1.1.10
+ **/
+gboolean
+pk_results_get_package_data (PkResults *results,
+			     guint idx,
+			     PkInfoEnum *info,
+			     const gchar **package_id,
+			     const gchar **summary)
+{
+	PkResultsPrivate *priv;
+
+	g_return_val_if_fail (PK_IS_RESULTS (results), FALSE);
+
+	/* packages already in the sack come first */
+	priv = results->priv;
+	if (idx < priv->package_array->len) {
+		PkPackage *package = g_ptr_array_index (priv->package_array, idx);
+		if (info != NULL)
+			*info = pk_package_get_info (package);
+		if (package_id != NULL)
+			*package_id = pk_package_get_id (package);
+		if (summary != NULL)
+			*summary = pk_package_get_summary (package);
+		return TRUE;
+	}
+	idx -= priv->package_array->len;
+	if (idx >= priv->package_ids->len)
+		return FALSE;
+	if (info != NULL)
+		*info = priv->package_infos->data[idx];
+	if (package_id != NULL)
+		*package_id = g_ptr_array_index (priv->package_ids, idx);
+	if (summary != NULL)
+		*summary = g_ptr_array_index (priv->package_summaries, idx);
+	return TRUE;
+}
+
+/**
+ * pk_results_package_iter_init:
+ * @iter: an uninitialized #PkResultsPackageIter
+ * @results: a valid #PkResults instance
+ *
+ * Initializes an iterator over the packages in @results, which does not
+ * create any #PkPackage objects. The iterator is invalid once packages
+ * are added to @results.
+ *
+ * |[
+ * PkResultsPackageIter iter;
+ * const gchar *package_id;
+ *
+ * pk_results_package_iter_init (&iter, results);
+ * while (pk_results_package_iter_next (&iter, NULL, &package_id, NULL))
+ *   g_print ("%s\n", package_id);
+ * ]|
+ *
+ * Since: 1.1.10
+ **/
+void
+pk_results_package_iter_init (PkResultsPackageIter *iter, PkResults *results)
+{
+	g_return_if_fail (iter != NULL);
+	g_return_if_fail (PK_IS_RESULTS (results));
+	iter->results = results;
+	iter->idx = 0;
+}
+
+/**
+ * pk_results_package_iter_next:
+ * @iter: an initialized #PkResultsPackageIter
+ * @info: (out) (optional): the #PkInfoEnum of the package
+ * @package_id: (out) (optional) (transfer none): the package ID
+ * @summary: (out) (optional) (transfer none): the package summary
+ *
+ * Advances @iter and gets the data for the next package, in the order the
+ * packages were added. See pk_results_get_package_data() for the lifetime
+ * of the strings.
+ *
+ * Return value: %FALSE if there are no more packages
+ *
+ * Since: 1.1.10
+ **/
+gboolean
+pk_results_package_iter_next (PkResultsPackageIter *iter,
+			      PkInfoEnum *info,
+			      const gchar **package_id,
+			      const gchar **summary)
+{
+	g_return_val_if_fail (iter != NULL, FALSE);
+	if (!pk_results_get_package_data (iter->results, iter->idx,
+					  info, package_id, summary))
+		return FALSE;
+	iter->idx++;
+	return TRUE;
+}
+
 /**
  * pk_results_get_package_sack:
  * @results: a valid #PkResults instance
@@ -595,6 +823,7 @@ PkPackageSack *
 pk_results_get_package_sack (PkResults *results)
 {
 	g_return_val_if_fail (PK_IS_RESULTS (results), NULL);
+	pk_results_materialize_packages (results);
 	return g_object_ref (results->priv->package_sack);
 }
 
@@ -898,6 +1127,12 @@ pk_results_init (PkResults *results)
 	results->priv->progress = NULL;
 	results->priv->error_code = NULL;
 	results->priv->package_sack = pk_package_sack_new ();
+	results->priv->package_array = pk_package_sack_get_array (results->priv->package_sack);
+	results->priv->package_strings = g_string_chunk_new (64 * 1024);
+	results->priv->package_infos = g_byte_array_new ();
+	results->priv->package_ids = g_ptr_array_new ();
+	results->priv->package_summaries = g_ptr_array_new ();
+	results->priv->package_tids = g_ptr_array_new ();
 	results->priv->details_array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	results->priv->update_detail_array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	results->priv->category_array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
@@ -931,7 +1166,13 @@ pk_results_finalize (GObject *object)
 	g_ptr_array_unref (priv->eula_required_array);
 	g_ptr_array_unref (priv->media_change_required_array);
 	g_ptr_array_unref (priv->repo_detail_array);
+	g_ptr_array_unref (priv->package_array);
 	g_object_unref (priv->package_sack);
+	g_string_chunk_free (priv->package_strings);
+	g_byte_array_unref (priv->package_infos);
+	g_ptr_array_unref (priv->package_ids);
+	g_ptr_array_unref (priv->package_summaries);
+	g_ptr_array_unref (priv->package_tids);
 	if (results->priv->progress != NULL)
 		g_object_unref (results->priv->progress);
 	if (results->priv->error_code != NULL)
@@ -67,6 +67,21 @@ struct _PkResults
 	 PkResultsPrivate	*priv;
 };
 
+/**
+ * PkResultsPackageIter:
+ *
+ * An opaque structure for iterating over the packages in a #PkResults.
+ * It is allocated on the stack and does not need to be freed.
+ *
+ * Since: 1.1.10
+ **/
+typedef struct {
+	/*< private >*/
+	PkResults	*results;
+	guint		 idx;
+	gpointer	 dummy[2];
+} PkResultsPackageIter;
+
 struct _PkResultsClass
 {
 	GObjectClass	parent_class;
@@ -92,6 +107,11 @@ gboolean	 pk_results_set_error_code 		(PkResults		*results,
 /* add */
 gboolean	 pk_results_add_package			(PkResults		*results,
 							 PkPackage		*item);
+gboolean	 pk_results_add_package_data		(PkResults		*results,
+							 PkInfoEnum		 info,
+							 const gchar		*package_id,
+							 const gchar		*summary,
+							 const gchar		*transaction_id);
 gboolean	 pk_results_add_details			(PkResults		*results,
 							 PkDetails		*item);
 gboolean	 pk_results_add_update_detail		(PkResults		*results,
@@ -122,6 +142,18 @@ PkError		*pk_results_get_error_code		(PkResults		*results);
 PkRoleEnum	 pk_results_get_role			(PkResults		*results);
 PkBitfield	 pk_results_get_transaction_flags	(PkResults		*results);
 PkRestartEnum	 pk_results_get_require_restart_worst	(PkResults		*results);
+guint		 pk_results_get_package_count		(PkResults		*results);
+gboolean	 pk_results_get_package_data		(PkResults		*results,
+							 guint			 idx,
+							 PkInfoEnum		*info,
+							 const gchar		**package_id,
+							 const gchar		**summary);
+void		 pk_results_package_iter_init		(PkResultsPackageIter	*iter,
+							 PkResults		*results);
+gboolean	 pk_results_package_iter_next		(PkResultsPackageIter	*iter,
+							 PkInfoEnum		*info,
+							 const gchar		**package_id,
+							 const gchar		**summary);
 
 /* get array objects */
 GPtrArray	*pk_results_get_package_array		(PkResults		*results);
@@ -24,6 +24,7 @@
 #include <string.h>
 #include <glib-object.h>
 #include <glib/gstdio.h>
+#include <gio/gunixfdlist.h>
 #include <gio/gunixsocketaddress.h>
 
 #include "pk-client.h"
@@ -1011,6 +1012,167 @@ pk_test_package_sack_filter_cb (PkPackage *package, gpointer user_data)
 	return TRUE;
 }
 
+static guint _stream_finished = 0;
+
+static void
+pk_test_client_stream_cb (PkClient *client, PkClientStreamType type,
+			  const PkClientStreamItem *item, gpointer user_data)
+{
+	GHashTable *counts = (GHashTable *) user_data;
+	guint count;
+
+	g_assert_cmpint (type, ==, PK_CLIENT_STREAM_TYPE_PACKAGE);
+	g_assert (pk_package_id_check (item->package_id));
+	g_assert (item->transaction_id != NULL);
+
+	/* count the items of each transaction */
+	count = GPOINTER_TO_UINT (g_hash_table_lookup (counts, item->transaction_id));
+	g_hash_table_insert (counts, g_strdup (item->transaction_id),
+			     GUINT_TO_POINTER (count + 1));
+}
+
+static void
+pk_test_client_stream_finished_cb (GObject *object, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(PkResults) results = NULL;
+
+	results = pk_client_generic_finish (PK_CLIENT (object), res, &error);
+	g_assert_no_error (error);
+	g_assert (results != NULL);
+	g_assert_cmpint (pk_results_get_exit_code (results), ==, PK_EXIT_ENUM_SUCCESS);
+
+	/* streamed packages are not kept */
+	g_assert_cmpint (pk_results_get_package_count (results), ==, 0);
+
+	if (++_stream_finished == 2)
+		_g_test_loop_quit ();
+}
+
+static void
+pk_test_client_stream_func (void)
+{
+	GHashTableIter iter;
+	gpointer value;
+	guint count = 0;
+	g_autoptr(GHashTable) counts = NULL;
+	g_autoptr(PkClient) client = NULL;
+
+	counts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	client = pk_client_new ();
+	pk_client_set_stream_callback (client, pk_test_client_stream_cb,
+				       g_hash_table_ref (counts),
+				       (GDestroyNotify) g_hash_table_unref);
+
+	/* run the same query twice at the same time on one client */
+	_stream_finished = 0;
+	pk_client_get_packages_async (client, pk_bitfield_value (PK_FILTER_ENUM_NONE),
+				      NULL, NULL, NULL,
+				      pk_test_client_stream_finished_cb, NULL);
+	pk_client_get_packages_async (client, pk_bitfield_value (PK_FILTER_ENUM_NONE),
+				      NULL, NULL, NULL,
+				      pk_test_client_stream_finished_cb, NULL);
+	_g_test_loop_run_with_timeout (15000);
+	g_assert_cmpint (_stream_finished, ==, 2);
+
+	/* the items can be told apart by transaction */
+	g_assert_cmpint (g_hash_table_size (counts), ==, 2);
+	g_hash_table_iter_init (&iter, counts);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		g_assert_cmpint (GPOINTER_TO_UINT (value), >, 0);
+		if (count > 0)
+			g_assert_cmpint (GPOINTER_TO_UINT (value), ==, count);
+		count = GPOINTER_TO_UINT (value);
+	}
+}
+
+static GDBusMessage *
+pk_test_client_bulk_results_filter_cb (GDBusConnection *connection,
+				       GDBusMessage *message,
+				       gboolean incoming,
+				       gpointer user_data)
+{
+	gint *received = (gint *) user_data;
+	GUnixFDList *fd_list;
+
+	if (!incoming ||
+	    g_strcmp0 (g_dbus_message_get_member (message), "BulkResults") != 0)
+		return message;
+	fd_list = g_dbus_message_get_unix_fd_list (message);
+	if (fd_list != NULL && g_unix_fd_list_get_length (fd_list) == 1)
+		g_atomic_int_inc (received);
+	return message;
+}
+
+static void
+pk_test_client_bulk_results_func (void)
+{
+	gboolean bulk_results;
+	gdouble elapsed[2];
+	gint received = 0;
+	guint filter_id;
+	guint i;
+	GError *error = NULL;
+	GPtrArray *packages[2];
+	PkResults *results;
+	g_autoptr(GDBusConnection) connection = NULL;
+	g_autoptr(GHashTable) package_ids = NULL;
+	g_autoptr(PkClient) client = NULL;
+	g_auto(GStrv) values = g_strsplit ("bulk", " ", -1);
+
+#ifndef HAVE_MEMFD_CREATE
+	g_test_skip ("the daemon cannot create a memfd");
+	return;
+#endif
+
+	client = pk_client_new ();
+	g_object_get (client, "bulk-results", &bulk_results, NULL);
+	g_assert (!bulk_results);
+
+	/* PkClient shares the system bus connection, so this sees the fds
+	 * the daemon sends */
+	connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
+	g_assert_no_error (error);
+	filter_id = g_dbus_connection_add_filter (connection,
+						  pk_test_client_bulk_results_filter_cb,
+						  &received, NULL);
+
+	/* the same large query, with one signal per package and then in bulk */
+	for (i = 0; i < 2; i++) {
+		pk_client_set_bulk_results (client, i == 1);
+		g_test_timer_start ();
+		results = pk_client_search_details (client,
+						    pk_bitfield_value (PK_FILTER_ENUM_NONE),
+						    values, NULL, NULL, NULL, &error);
+		elapsed[i] = g_test_timer_elapsed ();
+		g_assert_no_error (error);
+		g_assert (results != NULL);
+		g_assert_cmpint (pk_results_get_exit_code (results), ==, PK_EXIT_ENUM_SUCCESS);
+		packages[i] = pk_results_get_package_array (results);
+		g_object_unref (results);
+
+		/* the bulk path was really taken, rather than the fallback */
+		g_assert_cmpint (g_atomic_int_get (&received), ==, i);
+	}
+	g_dbus_connection_remove_filter (connection, filter_id);
+	g_test_message ("got %u packages in %fs, and in bulk in %fs",
+			packages[0]->len, elapsed[0], elapsed[1]);
+
+	g_assert_cmpint (packages[1]->len, ==, 20000);
+	g_assert_cmpint (packages[0]->len, ==, packages[1]->len);
+	package_ids = g_hash_table_new (g_str_hash, g_str_equal);
+	for (i = 0; i < packages[1]->len; i++) {
+		PkPackage *package = g_ptr_array_index (packages[1], i);
+		g_hash_table_add (package_ids, (gpointer) pk_package_get_id (package));
+	}
+	for (i = 0; i < packages[0]->len; i++) {
+		PkPackage *package = g_ptr_array_index (packages[0], i);
+		g_assert (g_hash_table_contains (package_ids, pk_package_get_id (package)));
+	}
+	g_ptr_array_unref (packages[0]);
+	g_ptr_array_unref (packages[1]);
+}
+
 static void
 pk_test_package_sack_func (void)
 {
@@ -1223,6 +1385,13 @@ pk_test_task_text_progress_cb (PkProgress *progress, PkProgressType type, gpoint
 	}
 }
 
+static void
+pk_test_task_text_stream_cb (PkClient *client, PkClientStreamType type,
+			     const PkClientStreamItem *item, gpointer user_data)
+{
+	g_assert_not_reached ();
+}
+
 static void
 pk_test_task_text_func (void)
 {
@@ -1232,6 +1401,11 @@ pk_test_task_text_func (void)
 	task = pk_task_text_new ();
 	g_assert (task != NULL);
 
+	/* the task reads its own results back, so it never streams */
+	pk_client_set_stream_callback (PK_CLIENT (task),
+				       pk_test_task_text_stream_cb,
+				       NULL, NULL);
+
 	/* For testing, you will need to manually do:
 	pkcon repo-set-data dummy use-gpg 1
 	pkcon repo-set-data dummy use-eula 1
@@ -1438,6 +1612,8 @@ main (int argc, char **argv)
 	g_test_add_func ("/packagekit-glib2/transaction-list", pk_test_transaction_list_func);
 	g_test_add_func ("/packagekit-glib2/client-helper", pk_test_client_helper_func);
 	g_test_add_func ("/packagekit-glib2/client", pk_test_client_func);
+	g_test_add_func ("/packagekit-glib2/client-stream", pk_test_client_stream_func);
+	g_test_add_func ("/packagekit-glib2/client-bulk-results", pk_test_client_bulk_results_func);
 	g_test_add_func ("/packagekit-glib2/package-sack", pk_test_package_sack_func);
 	g_test_add_func ("/packagekit-glib2/task", pk_test_task_func);
 	g_test_add_func ("/packagekit-glib2/task-wrapper", pk_test_task_wrapper_func);
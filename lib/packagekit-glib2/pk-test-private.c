@@ -22,7 +22,9 @@
 #include "config.h"
 
 #include <glib-object.h>
+#include <glib/gstdio.h>
 
+#include "pk-cnf-index-private.h"
 #include "pk-common.h"
 #include "pk-debug.h"
 #include "pk-enum.h"
@@ -325,6 +327,55 @@ pk_test_enum_func (void)
 	}
 }
 
+static void
+pk_test_enum_hash_func (void)
+{
+	const gchar *string;
+	gdouble elapsed;
+	guint i;
+	guint j;
+	g_autoptr(GTimer) timer = NULL;
+
+	/* every string maps back to the value it came from */
+	for (i = 0; i < PK_ROLE_ENUM_LAST; i++)
+		g_assert_cmpint (pk_role_enum_from_string (pk_role_enum_to_string (i)), ==, i);
+	for (i = 0; i < PK_STATUS_ENUM_LAST; i++)
+		g_assert_cmpint (pk_status_enum_from_string (pk_status_enum_to_string (i)), ==, i);
+	for (i = 0; i < PK_INFO_ENUM_LAST; i++)
+		g_assert_cmpint (pk_info_enum_from_string (pk_info_enum_to_string (i)), ==, i);
+	for (i = 0; i < PK_GROUP_ENUM_LAST; i++)
+		g_assert_cmpint (pk_group_enum_from_string (pk_group_enum_to_string (i)), ==, i);
+	for (i = 0; i < PK_ERROR_ENUM_LAST; i++)
+		g_assert_cmpint (pk_error_enum_from_string (pk_error_enum_to_string (i)), ==, i);
+	for (i = 0; i < PK_FILTER_ENUM_LAST; i++)
+		g_assert_cmpint (pk_filter_enum_from_string (pk_filter_enum_to_string (i)), ==, i);
+
+	/* unknown strings and out of range values use the first entry */
+	g_assert_cmpint (pk_info_enum_from_string ("installe"), ==, PK_INFO_ENUM_UNKNOWN);
+	g_assert_cmpint (pk_info_enum_from_string ("installedx"), ==, PK_INFO_ENUM_UNKNOWN);
+	g_assert_cmpint (pk_info_enum_from_string (""), ==, PK_INFO_ENUM_UNKNOWN);
+	g_assert_cmpint (pk_info_enum_from_string (NULL), ==, PK_INFO_ENUM_UNKNOWN);
+	g_assert_cmpstr (pk_info_enum_to_string (PK_INFO_ENUM_LAST), ==, "unknown");
+	g_assert_cmpstr (pk_info_enum_to_string (G_MAXUINT), ==, "unknown");
+
+	/* only time the lookups when asked to */
+	if (!g_test_perf ())
+		return;
+	timer = g_timer_new ();
+	for (j = 0; j < 100000; j++) {
+		for (i = 0; i < PK_INFO_ENUM_LAST; i++) {
+			string = pk_info_enum_to_string (i);
+			g_assert_cmpint (pk_info_enum_from_string (string), ==, i);
+		}
+		for (i = 0; i < PK_ERROR_ENUM_LAST; i++) {
+			string = pk_error_enum_to_string (i);
+			g_assert_cmpint (pk_error_enum_from_string (string), ==, i);
+		}
+	}
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_test_minimized_result (elapsed, "enum conversion took %.3fs", elapsed);
+}
+
 static void
 pk_test_package_id_func (void)
 {
@@ -462,6 +513,9 @@ pk_test_results_func (void)
 	PkInfoEnum info;
 	gchar *package_id;
 	gchar *summary;
+	const gchar *package_id_tmp;
+	const gchar *summary_tmp;
+	PkResultsPackageIter iter;
 	GError *error = NULL;
 
 	/* get results */
@@ -532,6 +586,58 @@ pk_test_results_func (void)
 	g_free (package_id);
 	g_free (summary);
 
+	/* add compact package data */
+	ret = pk_results_add_package_data (results,
+					   PK_INFO_ENUM_INSTALLED,
+					   "powertop;1.8-1;i386;installed",
+					   "Power consumption monitor",
+					   NULL);
+	g_assert (ret);
+	g_assert_cmpint (pk_results_get_package_count (results), ==, 2);
+
+	/* invalid package ids are not counted */
+	g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "invalid package id*");
+	ret = pk_results_add_package_data (results,
+					   PK_INFO_ENUM_INSTALLED,
+					   "powertop;1.8-1;i386",
+					   NULL, NULL);
+	g_test_assert_expected_messages ();
+	g_assert (!ret);
+	g_assert_cmpint (pk_results_get_package_count (results), ==, 2);
+
+	/* read it back without creating objects */
+	ret = pk_results_get_package_data (results, 1, &info,
+					   &package_id_tmp, &summary_tmp);
+	g_assert (ret);
+	g_assert_cmpint (info, ==, PK_INFO_ENUM_INSTALLED);
+	g_assert_cmpstr (package_id_tmp, ==, "powertop;1.8-1;i386;installed");
+	g_assert_cmpstr (summary_tmp, ==, "Power consumption monitor");
+	ret = pk_results_get_package_data (results, 2, NULL, NULL, NULL);
+	g_assert (!ret);
+
+	/* iterate over both the object and the compact package */
+	pk_results_package_iter_init (&iter, results);
+	ret = pk_results_package_iter_next (&iter, &info, &package_id_tmp, NULL);
+	g_assert (ret);
+	g_assert_cmpint (info, ==, PK_INFO_ENUM_AVAILABLE);
+	g_assert_cmpstr (package_id_tmp, ==, "gnome-power-manager;0.1.2;i386;fedora");
+	ret = pk_results_package_iter_next (&iter, &info, &package_id_tmp, &summary_tmp);
+	g_assert (ret);
+	g_assert_cmpint (info, ==, PK_INFO_ENUM_INSTALLED);
+	g_assert_cmpstr (summary_tmp, ==, "Power consumption monitor");
+	ret = pk_results_package_iter_next (&iter, NULL, NULL, NULL);
+	g_assert (!ret);
+
+	/* get package list, which creates the objects in order */
+	packages = pk_results_get_package_array (results);
+	g_assert_cmpint (packages->len, ==, 2);
+	item = g_ptr_array_index (packages, 1);
+	g_assert_cmpint (pk_package_get_info (item), ==, PK_INFO_ENUM_INSTALLED);
+	g_assert_cmpstr (pk_package_get_id (item), ==, "powertop;1.8-1;i386;installed");
+	g_assert_cmpstr (pk_package_get_summary (item), ==, "Power consumption monitor");
+	g_ptr_array_unref (packages);
+	g_assert_cmpint (pk_results_get_package_count (results), ==, 2);
+
 	g_object_unref (results);
 }
 
@@ -909,6 +1015,69 @@ pk_test_offline_upgrade_func (void)
 	g_assert (!g_file_test (PK_OFFLINE_RESULTS_FILENAME, G_FILE_TEST_EXISTS));
 }
 
+static void
+pk_test_cnf_index_func (void)
+{
+	const gchar *filename = "/tmp/PackageKit-self-test-cnf.idx";
+	gboolean ret;
+	gchar *files_powertop[] = { "/usr/sbin/powertop",
+				    "/usr/share/doc/powertop/README",
+				    NULL };
+	gchar *files_vim[] = { "/usr/bin/vi",
+			       "/usr/bin/vim",
+			       "/usr/bin/",
+			       "/usr/bin/subdir/hidden",
+			       NULL };
+	gchar *files_elvis[] = { "/bin/vi", "/bin/vi", NULL };
+	g_autoptr(GError) error = NULL;
+	g_autoptr(PkCnfIndex) index = NULL;
+	g_autoptr(PkCnfIndexBuilder) builder = NULL;
+	g_auto(GStrv) package_ids = NULL;
+
+	/* only executables in the search path are added */
+	builder = pk_cnf_index_builder_new ();
+	pk_cnf_index_builder_add_files (builder, "vim;7.4;i386;fedora", files_vim);
+	pk_cnf_index_builder_add_files (builder, "powertop;1.8-1;i386;fedora", files_powertop);
+	pk_cnf_index_builder_add_files (builder, "elvis;2.2;i386;fedora", files_elvis);
+	g_assert_cmpint (pk_cnf_index_builder_get_size (builder), ==, 5);
+	ret = pk_cnf_index_builder_save (builder, filename, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* map it back */
+	index = pk_cnf_index_new_from_file (filename, &error);
+	g_assert_no_error (error);
+	g_assert (index != NULL);
+	package_ids = pk_cnf_index_lookup (index, "powertop");
+	g_assert_cmpint (g_strv_length (package_ids), ==, 1);
+	g_assert_cmpstr (package_ids[0], ==, "powertop;1.8-1;i386;fedora");
+	g_strfreev (package_ids);
+
+	/* duplicates are removed and all providers are returned */
+	package_ids = pk_cnf_index_lookup (index, "vi");
+	g_assert_cmpint (g_strv_length (package_ids), ==, 2);
+	g_assert_cmpstr (package_ids[0], ==, "elvis;2.2;i386;fedora");
+	g_assert_cmpstr (package_ids[1], ==, "vim;7.4;i386;fedora");
+	g_strfreev (package_ids);
+
+	/* not found */
+	package_ids = pk_cnf_index_lookup (index, "hidden");
+	g_assert_cmpint (g_strv_length (package_ids), ==, 0);
+	g_strfreev (package_ids);
+	package_ids = pk_cnf_index_lookup (index, "zzz");
+	g_assert_cmpint (g_strv_length (package_ids), ==, 0);
+
+	/* invalid files are refused */
+	pk_cnf_index_free (g_steal_pointer (&index));
+	ret = g_file_set_contents (filename, "PKCNF01", -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	index = pk_cnf_index_new_from_file (filename, &error);
+	g_assert (error != NULL);
+	g_assert (index == NULL);
+	g_unlink (filename);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -923,7 +1092,9 @@ main (int argc, char **argv)
 	/* tests go here */
 	g_test_add_func ("/packagekit-glib2/common", pk_test_common_func);
 	g_test_add_func ("/packagekit-glib2/enum", pk_test_enum_func);
+	g_test_add_func ("/packagekit-glib2/enum-hash", pk_test_enum_hash_func);
 	g_test_add_func ("/packagekit-glib2/bitfield", pk_test_bitfield_func);
+	g_test_add_func ("/packagekit-glib2/cnf-index", pk_test_cnf_index_func);
 	g_test_add_func ("/packagekit-glib2/package-id", pk_test_package_id_func);
 	g_test_add_func ("/packagekit-glib2/package-ids", pk_test_package_ids_func);
 	g_test_add_func ("/packagekit-glib2/progress", pk_test_progress_func);
@@ -25,6 +25,8 @@
 from __future__ import print_function
 
 import sys
+import select
+import struct
 import traceback
 import os.path
 
@@ -67,6 +69,8 @@ class PackageKitBaseBackend:
         self.interactive = False
         self.cache_age = 0
         self.percentage_old = 0
+        self.binary_framing = False
+        self._protocol = sys.stdout
 
         # try to get LANG
         try:
@@ -107,6 +111,34 @@ class PackageKitBaseBackend:
         except KeyError as e:
             pass
 
+    def _emit(self, *fields):
+        '''
+        Write one command to the daemon, either as a tab separated line or
+        as a length prefixed record of NUL terminated fields
+        '''
+        fields = ['%s' % (field,) for field in fields]
+        if not self.binary_framing:
+            self._protocol.write(_to_utf8("\t".join(fields) + "\n"))
+            self._protocol.flush()
+            return
+        payload = b''.join([_to_bytes(field).replace(b'\0', b' ') + b'\0' for field in fields])
+        out = getattr(self._protocol, 'buffer', self._protocol)
+        out.write(struct.pack('<I', len(payload)) + payload)
+        out.flush()
+
+    def _negotiate_framing(self):
+        '''
+        Switch to binary records if the daemon offered them; the
+        acknowledgement itself is always sent as a text line. A stray
+        print() would corrupt the records, so from here on anything
+        written to sys.stdout goes to stderr instead
+        '''
+        if self.binary_framing or os.environ.get('FRAMING') != 'binary':
+            return
+        self._emit("framing", "binary")
+        self.binary_framing = True
+        sys.stdout = sys.stderr
+
     def doLock(self):
         ''' Generic locking, overide and extend in child class'''
         self._locked = True
@@ -124,19 +156,17 @@ class PackageKitBaseBackend:
         @param percent: Progress percentage (int preferred)
         '''
         if percent == None:
-            sys.stdout.write(_to_utf8("no-percentage-updates\n"))
+            self._emit("no-percentage-updates")
         elif percent == 0 or percent > self.percentage_old:
-            sys.stdout.write(_to_utf8("percentage\t%i\n" % percent))
+            self._emit("percentage", "%i" % percent)
             self.percentage_old = percent
-        sys.stdout.flush()
 
     def speed(self, bps=0):
         '''
         Write progress speed
         @param bps: Progress speed (int, bytes per second)
         '''
-        sys.stdout.write(_to_utf8("speed\t%i\n" % bps))
-        sys.stdout.flush()
+        self._emit("speed", "%i" % bps)
 
     def item_progress(self, package_id, status, percent=None):
         '''
@@ -144,8 +174,7 @@ class PackageKitBaseBackend:
         @param package_id: The package ID name, e.g. openoffice-clipart;2.6.22;ppc64;fedora
         @param percent: percentage of the current item (int preferred)
         '''
-        sys.stdout.write(_to_utf8("item-progress\t%s\t%s\t%i\n" % (package_id, status, percent)))
-        sys.stdout.flush()
+        self._emit("item-progress", package_id, status, "%i" % percent)
 
     def error(self, err, description, exit=True):
         '''
@@ -159,8 +188,7 @@ class PackageKitBaseBackend:
             self.unLock()
 
         # this should be fast now
-        sys.stdout.write(_to_utf8("error\t%s\t%s\n" % (err, description)))
-        sys.stdout.flush()
+        self._emit("error", err, description)
         if exit:
             # Paradoxically, we don't want to print "finished" to stdout here.
             # Python takes an _enormous_ amount of time to exit, and leaves a
@@ -174,8 +202,7 @@ class PackageKitBaseBackend:
         send 'message' signal
         @param typ: MESSAGE_BROKEN_MIRROR
         '''
-        sys.stdout.write(_to_utf8("message\t%s\t%s\n" % (typ, msg)))
-        sys.stdout.flush()
+        self._emit("message", typ, msg)
 
     def package(self, package_id, status, summary):
         '''
@@ -184,8 +211,7 @@ class PackageKitBaseBackend:
         @param package_id: The package ID name, e.g. openoffice-clipart;2.6.22;ppc64;fedora
         @param summary: The package Summary
         '''
-        sys.stdout.write(_to_utf8("package\t%s\t%s\t%s\n" % (status, package_id, summary)))
-        sys.stdout.flush()
+        self._emit("package", status, package_id, summary)
 
     def media_change_required(self, mtype, id, text):
         '''
@@ -194,8 +220,7 @@ class PackageKitBaseBackend:
         @param id: the localised label of the media
         @param text: the localised text describing the media
         '''
-        sys.stdout.write(_to_utf8("media-change-required\t%s\t%s\t%s\n" % (mtype, id, text)))
-        sys.stdout.flush()
+        self._emit("media-change-required", mtype, id, text)
 
     def distro_upgrade(self, dtype, name, summary):
         '''
@@ -204,16 +229,14 @@ class PackageKitBaseBackend:
         @param name: The distro name, e.g. "fedora-9"
         @param summary: The localised distribution name and description
         '''
-        sys.stdout.write(_to_utf8("distro-upgrade\t%s\t%s\t%s\n" % (dtype, name, summary)))
-        sys.stdout.flush()
+        self._emit("distro-upgrade", dtype, name, summary)
 
     def status(self, state):
         '''
         send 'status' signal
         @param state: STATUS_DOWNLOAD, STATUS_INSTALL, STATUS_UPDATE, STATUS_REMOVE, STATUS_WAIT
         '''
-        sys.stdout.write(_to_utf8("status\t%s\n" % state))
-        sys.stdout.flush()
+        self._emit("status", state)
 
     def repo_detail(self, repoid, name, state):
         '''
@@ -221,16 +244,14 @@ class PackageKitBaseBackend:
         @param repoid: The repo id tag
         @param state: false is repo is disabled else true.
         '''
-        sys.stdout.write(_to_utf8("repo-detail\t%s\t%s\t%s\n" % (repoid, name, _bool_to_string(state))))
-        sys.stdout.flush()
+        self._emit("repo-detail", repoid, name, _bool_to_string(state))
 
     def data(self, data):
         '''
         send 'data' signal:
         @param data:  The current worked on package
         '''
-        sys.stdout.write(_to_utf8("data\t%s\n" % data))
-        sys.stdout.flush()
+        self._emit("data", data)
 
     def details(self, package_id, summary, package_license, group, desc, url, bytes):
         '''
@@ -243,16 +264,14 @@ class PackageKitBaseBackend:
         @param url: The upstream project homepage
         @param bytes: The size of the package, in bytes
         '''
-        sys.stdout.write(_to_utf8("details\t%s\t%s\t%s\t%s\t%s\t%s\t%ld\n" % (package_id, summary, package_license, group, desc, url, bytes)))
-        sys.stdout.flush()
+        self._emit("details", package_id, summary, package_license, group, desc, url, "%ld" % bytes)
 
     def files(self, package_id, file_list):
         '''
         Send 'files' signal
         @param file_list: List of the files in the package, separated by ';'
         '''
-        sys.stdout.write(_to_utf8("files\t%s\t%s\n" % (package_id, file_list)))
-        sys.stdout.flush()
+        self._emit("files", package_id, file_list)
 
     def category(self, parent_id, cat_id, name, summary, icon):
         '''
@@ -263,15 +282,13 @@ class PackageKitBaseBackend:
         summery   : a summary of the category in current locale.
         icon      : an icon name to represent the category
         '''
-        sys.stdout.write(_to_utf8("category\t%s\t%s\t%s\t%s\t%s\n" % (parent_id, cat_id, name, summary, icon)))
-        sys.stdout.flush()
+        self._emit("category", parent_id, cat_id, name, summary, icon)
 
     def finished(self):
         '''
         Send 'finished' signal
         '''
-        sys.stdout.write(_to_utf8("finished\n"))
-        sys.stdout.flush()
+        self._emit("finished")
 
     def update_detail(self, package_id, updates, obsoletes, vendor_url, bugzilla_url, cve_url, restart, update_text, changelog, state, issued, updated):
         '''
@@ -289,8 +306,7 @@ class PackageKitBaseBackend:
         @param issued:
         @param updated:
         '''
-        sys.stdout.write(_to_utf8("updatedetail\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n" % (package_id, updates, obsoletes, vendor_url, bugzilla_url, cve_url, restart, update_text, changelog, state, issued, updated)))
-        sys.stdout.flush()
+        self._emit("updatedetail", package_id, updates, obsoletes, vendor_url, bugzilla_url, cve_url, restart, update_text, changelog, state, issued, updated)
 
     def require_restart(self, restart_type, details):
         '''
@@ -298,8 +314,7 @@ class PackageKitBaseBackend:
         @param restart_type: RESTART_SYSTEM, RESTART_APPLICATION, RESTART_SESSION
         @param details: Optional details about the restart
         '''
-        sys.stdout.write(_to_utf8("requirerestart\t%s\t%s\n" % (restart_type, details)))
-        sys.stdout.flush()
+        self._emit("requirerestart", restart_type, details)
 
     def allow_cancel(self, allow):
         '''
@@ -310,8 +325,7 @@ class PackageKitBaseBackend:
             data = 'true'
         else:
             data = 'false'
-        sys.stdout.write(_to_utf8("allow-cancel\t%s\n" % data))
-        sys.stdout.flush()
+        self._emit("allow-cancel", data)
 
     def repo_signature_required(self, package_id, repo_name, key_url, key_userid, key_id, key_fingerprint, key_timestamp, sig_type):
         '''
@@ -325,10 +339,8 @@ class PackageKitBaseBackend:
         @param key_timestamp:   Key timestamp
         @param sig_type:        Key type (GPG)
         '''
-        sys.stdout.write(_to_utf8("repo-signature-required\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n" % (
-            package_id, repo_name, key_url, key_userid, key_id, key_fingerprint, key_timestamp, sig_type
-            )))
-        sys.stdout.flush()
+        self._emit("repo-signature-required",
+                   package_id, repo_name, key_url, key_userid, key_id, key_fingerprint, key_timestamp, sig_type)
 
     def eula_required(self, eula_id, package_id, vendor_name, license_agreement):
         '''
@@ -338,10 +350,7 @@ class PackageKitBaseBackend:
         @param vendor_name:     Name of the vendor that wrote the EULA
         @param license_agreement: The license text
         '''
-        sys.stdout.write(_to_utf8("eula-required\t%s\t%s\t%s\t%s\n" % (
-            eula_id, package_id, vendor_name, license_agreement
-            )))
-        sys.stdout.flush()
+        self._emit("eula-required", eula_id, package_id, vendor_name, license_agreement)
 
 #
 # Backend Action Methods
@@ -577,6 +586,7 @@ class PackageKitBaseBackend:
         fname = os.path.split(self.cmds[0])[1]
         cmd = fname.split('.')[0] # get the helper filename wo ext
         args = self.cmds[1:]
+        self._negotiate_framing()
         self.dispatch_command(cmd, args)
 
     def dispatch_command(self, cmd, args):
@@ -724,10 +734,22 @@ class PackageKitBaseBackend:
             self.error(ERROR_INTERNAL_ERROR, errmsg, exit=False)
             self.finished()
 
+    def idle(self):
+        '''
+        Called between commands in dispatcher mode to do background work.
+        Return True while there is more to do; nothing may be emitted here.
+        '''
+        return False
+
     def dispatcher(self, args):
+        self._negotiate_framing()
         if len(args) > 0:
             self.dispatch_command(args[0], args[1:])
         while True:
+            # keep working in the background until the next command arrives
+            while self.idle():
+                if select.select([sys.stdin], [], [], 0)[0]:
+                    break
             try:
                 line = sys.stdin.readline().strip('\n')
             except IOError as e:
@@ -745,6 +767,11 @@ class PackageKitBaseBackend:
         sys.exit(0)
 
 
+def _to_bytes(txt):
+    if isinstance(txt, bytes):
+        return txt
+    return txt.encode('utf-8', 'replace')
+
 def format_string(text, encoding='utf-8'):
     '''
     Format a string to be used on stdout for communication with the daemon.
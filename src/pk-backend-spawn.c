@@ -54,6 +54,9 @@
 
 #define	PK_UNSAFE_DELIMITERS	"\\\f\r\t"
 
+/* the largest number of fields any command uses, plus some headroom */
+#define PK_BACKEND_SPAWN_MAX_SECTIONS	16
+
 struct PkBackendSpawnPrivate
 {
 	PkSpawn			*spawn;
@@ -139,15 +142,18 @@ pk_backend_spawn_start_kill_timer (PkBackendSpawn *backend_spawn)
 }
 
 /**
- * pk_backend_spawn_parse_stdout:
+ * pk_backend_spawn_parse_sections:
+ *
+ * Handles one command from the helper, already split into fields. The
+ * fields may be modified in place.
  **/
 static gboolean
-pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
-			       PkBackendJob *job,
-			       const gchar *line,
-			       GError **error)
+pk_backend_spawn_parse_sections (PkBackendSpawn *backend_spawn,
+				 PkBackendJob *job,
+				 gchar **sections,
+				 guint size,
+				 GError **error)
 {
-	guint size;
 	gchar *command;
 	gchar *text;
 	guint64 speed;
@@ -165,21 +171,9 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 	PkMediaTypeEnum media_type_enum;
 	PkDistroUpgradeEnum distro_upgrade_enum;
 	PkBackendSpawnPrivate *priv = backend_spawn->priv;
-	g_auto(GStrv) sections = NULL;
-
-	g_return_val_if_fail (PK_IS_BACKEND_SPAWN (backend_spawn), FALSE);
 
-	/* check if output line */
-	if (line == NULL)
-		return FALSE;
-
-	/* split by tab */
-	sections = g_strsplit (line, "\t", 0);
 	command = sections[0];
 
-	/* get size */
-	size = g_strv_length (sections);
-
 	if (g_strcmp0 (command, "package") == 0) {
 		if (size != 4) {
 			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
@@ -561,6 +555,16 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 			return FALSE;
 		}
 		pk_backend_job_category (job, sections[1], sections[2], sections[3], sections[4], sections[5]);
+	} else if (g_strcmp0 (command, "framing") == 0) {
+		if (size != 2) {
+			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
+			return FALSE;
+		}
+		if (g_strcmp0 (sections[1], "binary") != 0) {
+			g_set_error (error, 1, 0, "invalid framing '%s'", sections[1]);
+			return FALSE;
+		}
+		pk_spawn_set_framing (priv->spawn, PK_SPAWN_FRAMING_BINARY);
 	} else {
 		g_set_error (error, 1, 0, "invalid command '%s'", command);
 		return FALSE;
@@ -568,6 +572,69 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 	return TRUE;
 }
 
+/**
+ * pk_backend_spawn_parse_stdout:
+ **/
+static gboolean
+pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
+			       PkBackendJob *job,
+			       const gchar *line,
+			       GError **error)
+{
+	g_auto(GStrv) sections = NULL;
+
+	g_return_val_if_fail (PK_IS_BACKEND_SPAWN (backend_spawn), FALSE);
+
+	/* check if output line */
+	if (line == NULL)
+		return FALSE;
+
+	/* split by tab */
+	sections = g_strsplit (line, "\t", 0);
+	return pk_backend_spawn_parse_sections (backend_spawn, job, sections,
+						g_strv_length (sections), error);
+}
+
+/**
+ * pk_backend_spawn_parse_record:
+ *
+ * A binary record is a list of NUL terminated fields, which are parsed
+ * in place without copying.
+ **/
+static gboolean
+pk_backend_spawn_parse_record (PkBackendSpawn *backend_spawn,
+			       PkBackendJob *job,
+			       gchar *data,
+			       gsize len,
+			       GError **error)
+{
+	gchar *sections[PK_BACKEND_SPAWN_MAX_SECTIONS + 1];
+	gchar *end;
+	gchar *field;
+	gchar *tmp;
+	guint size = 0;
+
+	g_return_val_if_fail (PK_IS_BACKEND_SPAWN (backend_spawn), FALSE);
+
+	/* the last field has to be terminated too */
+	if (data == NULL || len == 0 || data[len - 1] != '\0') {
+		g_set_error_literal (error, 1, 0, "invalid record");
+		return FALSE;
+	}
+
+	end = data + len;
+	for (field = data; field < end; field = tmp + 1) {
+		if (size == PK_BACKEND_SPAWN_MAX_SECTIONS) {
+			g_set_error (error, 1, 0, "too many fields in record '%s'", data);
+			return FALSE;
+		}
+		sections[size++] = field;
+		tmp = memchr (field, '\0', end - field);
+	}
+	sections[size] = NULL;
+	return pk_backend_spawn_parse_sections (backend_spawn, job, sections, size, error);
+}
+
 /**
  * pk_backend_spawn_exit_cb:
  **/
@@ -627,6 +694,23 @@ pk_backend_spawn_inject_data (PkBackendSpawn *backend_spawn,
 	return pk_backend_spawn_parse_stdout (backend_spawn, job, line, error);
 }
 
+/**
+ * pk_backend_spawn_inject_record:
+ *
+ * Like pk_backend_spawn_inject_data() but for one binary record, which is
+ * modified in place.
+ **/
+gboolean
+pk_backend_spawn_inject_record (PkBackendSpawn *backend_spawn,
+				PkBackendJob *job,
+				gchar *data,
+				gsize len,
+				GError **error)
+{
+	g_return_val_if_fail (PK_IS_BACKEND_SPAWN (backend_spawn), FALSE);
+	return pk_backend_spawn_parse_record (backend_spawn, job, data, len, error);
+}
+
 /**
  * pk_backend_spawn_stdout_cb:
  **/
@@ -643,6 +727,23 @@ pk_backend_spawn_stdout_cb (PkBackendSpawn *spawn, const gchar *line, PkBackendS
 		g_warning ("failed to parse: %s: %s", line, error->message);
 }
 
+/**
+ * pk_backend_spawn_stdout_record_cb:
+ **/
+static void
+pk_backend_spawn_stdout_record_cb (PkSpawn *spawn, gchar *data, guint len,
+				   PkBackendSpawn *backend_spawn)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	ret = pk_backend_spawn_inject_record (backend_spawn,
+					      backend_spawn->priv->job,
+					      data, len,
+					      &error);
+	if (!ret)
+		g_warning ("failed to parse record: %s", error->message);
+}
+
 /**
  * pk_backend_spawn_stderr_cb:
  **/
@@ -787,6 +888,10 @@ pk_backend_spawn_get_envp (PkBackendSpawn *backend_spawn)
 			      g_strdup ("UID"),
 			      g_strdup_printf ("%u", pk_backend_job_get_uid (priv->job)));
 
+	/* FRAMING: the stdout filter only understands lines */
+	if (priv->stdout_func == NULL)
+		g_hash_table_replace (env_table, g_strdup ("FRAMING"), g_strdup ("binary"));
+
 	/* CACHE_AGE */
 	cache_age = pk_backend_job_get_cache_age (priv->job);
 	if (cache_age == G_MAXUINT) {
@@ -1122,6 +1227,8 @@ pk_backend_spawn_new (GKeyFile *conf)
 			  G_CALLBACK (pk_backend_spawn_exit_cb), backend_spawn);
 	g_signal_connect (backend_spawn->priv->spawn, "stdout",
 			  G_CALLBACK (pk_backend_spawn_stdout_cb), backend_spawn);
+	g_signal_connect (backend_spawn->priv->spawn, "stdout-record",
+			  G_CALLBACK (pk_backend_spawn_stdout_record_cb), backend_spawn);
 	g_signal_connect (backend_spawn->priv->spawn, "stderr",
 			  G_CALLBACK (pk_backend_spawn_stderr_cb), backend_spawn);
 	return PK_BACKEND_SPAWN (backend_spawn);
@@ -38,8 +38,11 @@
 #include <glib/gi18n.h>
 #include <glib/gstdio.h>
 #include <gio/gunixfdlist.h>
+#include <packagekit-glib2/pk-cnf-index-private.h>
+#include <packagekit-glib2/pk-files.h>
 #include <packagekit-glib2/pk-offline.h>
 #include <packagekit-glib2/pk-offline-private.h>
+#include <packagekit-glib2/pk-package.h>
 #include <packagekit-glib2/pk-version.h>
 #include <polkit/polkit.h>
 
@@ -58,6 +61,7 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(PolkitSubject, g_object_unref)
 
 static void     pk_engine_finalize	(GObject       *object);
 static void	pk_engine_set_locked (PkEngine *engine, gboolean is_locked);
+static void	pk_engine_cnf_index_check (PkEngine *engine, gchar **transaction_list);
 
 #define PK_ENGINE_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_ENGINE, PkEnginePrivate))
 
@@ -98,6 +102,11 @@ struct PkEnginePrivate
 	guint			 owner_id;
 	GDBusNodeInfo		*introspection;
 	GDBusConnection		*connection;
+	gboolean		 cnf_index_pending;
+	gboolean		 cnf_index_stale;
+	PkBackendJob		*cnf_index_job;
+	PkCnfIndexBuilder	*cnf_index_builder;
+	GHashTable		*cnf_index_package_ids;
 #ifdef HAVE_SYSTEMD
 	GDBusProxy		*logind_proxy;
 	gint			 logind_fd;
@@ -198,6 +207,9 @@ pk_engine_scheduler_changed_cb (PkScheduler *scheduler, PkEngine *engine)
 						      transaction_list),
 				       NULL);
 	pk_engine_reset_timer (engine);
+
+	/* start or cancel the command-not-found index job */
+	pk_engine_cnf_index_check (engine, transaction_list);
 }
 
 /**
@@ -377,14 +389,45 @@ pk_engine_backend_repo_list_changed_cb (PkBackend *backend, PkEngine *engine)
 				       NULL);
 }
 
+/**
+ * pk_engine_cnf_index_reset:
+ *
+ * Drops a partly built command-not-found index, so the next rebuild
+ * starts from scratch.
+ **/
+static void
+pk_engine_cnf_index_reset (PkEngine *engine)
+{
+	PkEnginePrivate *priv = engine->priv;
+	g_hash_table_remove_all (priv->cnf_index_package_ids);
+	g_clear_pointer (&priv->cnf_index_builder, pk_cnf_index_builder_free);
+	priv->cnf_index_stale = FALSE;
+}
+
 /**
  * pk_engine_backend_updates_changed_cb:
  **/
 static void
 pk_engine_backend_updates_changed_cb (PkBackend *backend, PkEngine *engine)
 {
+	g_auto(GStrv) transaction_list = NULL;
+
 	g_return_if_fail (PK_IS_ENGINE (engine));
 
+	/* the available packages may have changed */
+	if (g_key_file_get_boolean (engine->priv->conf, "Daemon",
+				    "CommandNotFoundIndex", NULL) &&
+	    pk_bitfield_contain (engine->priv->roles, PK_ROLE_ENUM_GET_PACKAGES) &&
+	    pk_bitfield_contain (engine->priv->roles, PK_ROLE_ENUM_GET_FILES)) {
+		engine->priv->cnf_index_pending = TRUE;
+		if (engine->priv->cnf_index_job != NULL)
+			engine->priv->cnf_index_stale = TRUE;
+		else
+			pk_engine_cnf_index_reset (engine);
+		transaction_list = pk_scheduler_get_array (engine->priv->scheduler);
+		pk_engine_cnf_index_check (engine, transaction_list);
+	}
+
 	g_debug ("emitting UpdatesChanged");
 	g_dbus_connection_emit_signal (engine->priv->connection,
 				       NULL,
@@ -395,6 +438,181 @@ pk_engine_backend_updates_changed_cb (PkBackend *backend, PkEngine *engine)
 				       NULL);
 }
 
+/**
+ * pk_engine_cnf_index_package_cb:
+ **/
+static void
+pk_engine_cnf_index_package_cb (PkBackendJob *job, gpointer object, gpointer user_data)
+{
+	PkEngine *engine = PK_ENGINE (user_data);
+	PkPackage *pkg = PK_PACKAGE (object);
+	g_hash_table_add (engine->priv->cnf_index_package_ids,
+			  g_strdup (pk_package_get_id (pkg)));
+}
+
+/**
+ * pk_engine_cnf_index_files_cb:
+ **/
+static void
+pk_engine_cnf_index_files_cb (PkBackendJob *job, gpointer object, gpointer user_data)
+{
+	PkEngine *engine = PK_ENGINE (user_data);
+	PkFiles *item = PK_FILES (object);
+	pk_cnf_index_builder_add_files (engine->priv->cnf_index_builder,
+					pk_files_get_package_id (item),
+					pk_files_get_files (item));
+
+	/* only the packages left need their files if this is cancelled */
+	g_hash_table_remove (engine->priv->cnf_index_package_ids,
+			     pk_files_get_package_id (item));
+}
+
+static void pk_engine_cnf_index_finished_cb (PkBackendJob *job, gpointer object, gpointer user_data);
+
+/**
+ * pk_engine_cnf_index_run:
+ *
+ * Runs one stage of the index job directly on the backend, in the same
+ * way as a transaction would.
+ **/
+static void
+pk_engine_cnf_index_run (PkEngine *engine, PkRoleEnum role)
+{
+	PkEnginePrivate *priv = engine->priv;
+	PkBitfield filters;
+	g_autofree gchar **keys = NULL;
+	g_auto(GStrv) package_ids = NULL;
+
+	priv->cnf_index_job = pk_backend_job_new (priv->conf);
+	pk_backend_job_set_background (priv->cnf_index_job, TRUE);
+	pk_backend_job_set_vfunc (priv->cnf_index_job,
+				  PK_BACKEND_SIGNAL_PACKAGE,
+				  pk_engine_cnf_index_package_cb,
+				  engine);
+	pk_backend_job_set_vfunc (priv->cnf_index_job,
+				  PK_BACKEND_SIGNAL_FILES,
+				  pk_engine_cnf_index_files_cb,
+				  engine);
+	pk_backend_job_set_vfunc (priv->cnf_index_job,
+				  PK_BACKEND_SIGNAL_FINISHED,
+				  pk_engine_cnf_index_finished_cb,
+				  engine);
+	pk_backend_start_job (priv->backend, priv->cnf_index_job);
+	pk_backend_job_set_role (priv->cnf_index_job, role);
+	if (role == PK_ROLE_ENUM_GET_PACKAGES) {
+		filters = pk_bitfield_from_enums (PK_FILTER_ENUM_NOT_INSTALLED,
+						  PK_FILTER_ENUM_NEWEST,
+						  PK_FILTER_ENUM_ARCH, -1);
+		pk_backend_get_packages (priv->backend, priv->cnf_index_job, filters);
+		return;
+	}
+	keys = (gchar **) g_hash_table_get_keys_as_array (priv->cnf_index_package_ids, NULL);
+	package_ids = g_strdupv (keys);
+	pk_backend_get_files (priv->backend, priv->cnf_index_job, package_ids);
+}
+
+/**
+ * pk_engine_cnf_index_finished_cb:
+ **/
+static void
+pk_engine_cnf_index_finished_cb (PkBackendJob *job, gpointer object, gpointer user_data)
+{
+	PkEngine *engine = PK_ENGINE (user_data);
+	PkEnginePrivate *priv = engine->priv;
+	PkExitEnum exit_enum = GPOINTER_TO_UINT (object);
+	PkRoleEnum role = pk_backend_job_get_role (job);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(PkBackendJob) job_tmp = NULL;
+	g_auto(GStrv) transaction_list = NULL;
+
+	/* the job is done with */
+	job_tmp = g_steal_pointer (&priv->cnf_index_job);
+	pk_backend_stop_job (priv->backend, job);
+
+	/* all the file lists arrived before the cancel took effect */
+	if (exit_enum == PK_EXIT_ENUM_CANCELLED &&
+	    role == PK_ROLE_ENUM_GET_FILES &&
+	    g_hash_table_size (priv->cnf_index_package_ids) == 0)
+		exit_enum = PK_EXIT_ENUM_SUCCESS;
+
+	if (exit_enum != PK_EXIT_ENUM_SUCCESS) {
+		g_debug ("command-not-found index %s: %s",
+			 pk_role_enum_to_string (role),
+			 pk_exit_enum_to_string (exit_enum));
+		if (exit_enum == PK_EXIT_ENUM_CANCELLED)
+			priv->cnf_index_pending = TRUE;
+
+		/* carry on with the file lists still missing next time,
+		 * unless the available packages changed meanwhile */
+		if (exit_enum != PK_EXIT_ENUM_CANCELLED ||
+		    role != PK_ROLE_ENUM_GET_FILES ||
+		    priv->cnf_index_stale)
+			pk_engine_cnf_index_reset (engine);
+		goto out;
+	}
+
+	/* now get the file lists */
+	if (role == PK_ROLE_ENUM_GET_PACKAGES &&
+	    g_hash_table_size (priv->cnf_index_package_ids) > 0) {
+		pk_engine_cnf_index_run (engine, PK_ROLE_ENUM_GET_FILES);
+		return;
+	}
+
+	/* write the new index */
+	if (!pk_cnf_index_builder_save (priv->cnf_index_builder,
+					PK_CNF_INDEX_FILENAME,
+					&error)) {
+		g_warning ("failed to write command-not-found index: %s",
+			   error->message);
+	}
+	pk_engine_cnf_index_reset (engine);
+out:
+	pk_scheduler_set_paused (priv->scheduler, FALSE);
+
+	/* the available packages may have changed again */
+	transaction_list = pk_scheduler_get_array (priv->scheduler);
+	pk_engine_cnf_index_check (engine, transaction_list);
+}
+
+/**
+ * pk_engine_cnf_index_check:
+ *
+ * Starts rebuilding the command-not-found index when it is out of date
+ * and nothing else is using the backend, and cancels the rebuild when a
+ * client needs the backend instead. A rebuild cancelled while getting
+ * the file lists is resumed where it stopped.
+ **/
+static void
+pk_engine_cnf_index_check (PkEngine *engine, gchar **transaction_list)
+{
+	PkEnginePrivate *priv = engine->priv;
+
+	/* clients always win */
+	if (priv->cnf_index_job != NULL) {
+		if (g_strv_length (transaction_list) > 0) {
+			g_debug ("cancelling command-not-found index for client");
+			pk_backend_cancel (priv->backend, priv->cnf_index_job);
+		}
+		return;
+	}
+	if (!priv->cnf_index_pending)
+		return;
+	if (g_strv_length (transaction_list) > 0)
+		return;
+
+	priv->cnf_index_pending = FALSE;
+	pk_scheduler_set_paused (priv->scheduler, TRUE);
+	if (priv->cnf_index_builder != NULL) {
+		g_debug ("resuming command-not-found index with %u packages left",
+			 g_hash_table_size (priv->cnf_index_package_ids));
+		pk_engine_cnf_index_run (engine, PK_ROLE_ENUM_GET_FILES);
+		return;
+	}
+	g_debug ("rebuilding command-not-found index");
+	priv->cnf_index_builder = pk_cnf_index_builder_new ();
+	pk_engine_cnf_index_run (engine, PK_ROLE_ENUM_GET_PACKAGES);
+}
+
 /**
  * pk_engine_state_changed_cb:
  *
@@ -468,6 +686,12 @@ pk_engine_get_seconds_idle (PkEngine *engine)
 		return 0;
 	}
 
+	/* the command-not-found index is being rebuilt */
+	if (engine->priv->cnf_index_job != NULL) {
+		g_debug ("engine idle zero as the command-not-found index is being rebuilt");
+		return 0;
+	}
+
 	/* have we been updated? */
 	if (engine->priv->notify_clients_of_upgrade) {
 		pk_engine_emit_restart_schedule (engine);
@@ -1939,6 +2163,10 @@ pk_engine_init (PkEngine *engine)
 	g_autofree gchar *filename = NULL;
 
 	engine->priv = PK_ENGINE_GET_PRIVATE (engine);
+	engine->priv->cnf_index_package_ids = g_hash_table_new_full (g_str_hash,
+								     g_str_equal,
+								     g_free,
+								     NULL);
 
 	/* load introspection */
 	engine->priv->introspection = pk_load_introspection (PK_DBUS_INTERFACE ".xml",
@@ -2017,6 +2245,24 @@ pk_engine_finalize (GObject *object)
 		engine->priv->timeout_normal_id = 0;
 	}
 
+	/* stop the command-not-found index job */
+	if (engine->priv->cnf_index_job != NULL) {
+		pk_backend_job_set_vfunc (engine->priv->cnf_index_job,
+					  PK_BACKEND_SIGNAL_PACKAGE,
+					  NULL, NULL);
+		pk_backend_job_set_vfunc (engine->priv->cnf_index_job,
+					  PK_BACKEND_SIGNAL_FILES,
+					  NULL, NULL);
+		pk_backend_job_set_vfunc (engine->priv->cnf_index_job,
+					  PK_BACKEND_SIGNAL_FINISHED,
+					  NULL, NULL);
+		pk_backend_stop_job (engine->priv->backend,
+				     engine->priv->cnf_index_job);
+		g_object_unref (engine->priv->cnf_index_job);
+	}
+	pk_cnf_index_builder_free (engine->priv->cnf_index_builder);
+	g_hash_table_unref (engine->priv->cnf_index_package_ids);
+
 	/* unlock if we locked this */
 	if (!pk_backend_unload (engine->priv->backend))
 		g_warning ("couldn't unload the backend");
@@ -2068,6 +2314,12 @@ pk_engine_new (GKeyFile *conf)
 	PkEngine *engine;
 	engine = g_object_new (PK_TYPE_ENGINE, NULL);
 	engine->priv->conf = g_key_file_ref (conf);
+
+	/* do not leave an old index around for command-not-found to use */
+	if (!g_key_file_get_boolean (conf, "Daemon", "CommandNotFoundIndex", NULL) &&
+	    g_unlink (PK_CNF_INDEX_FILENAME) == 0)
+		g_debug ("removed %s as the index is disabled", PK_CNF_INDEX_FILENAME);
+
 	engine->priv->backend = pk_backend_new (engine->priv->conf);
 	g_signal_connect (engine->priv->backend, "repo-list-changed",
 			  G_CALLBACK (pk_engine_backend_repo_list_changed_cb), engine);
@@ -93,6 +93,7 @@ struct PkSchedulerPrivate
 	GKeyFile		*conf;
 	PkBackend		*backend;
 	GDBusNodeInfo		*introspection;
+	gboolean		 paused;
 };
 
 typedef struct {
@@ -432,6 +433,10 @@ pk_scheduler_get_next_item (PkScheduler *scheduler)
 
 	array = scheduler->priv->array;
 
+	/* the engine is using the backend */
+	if (scheduler->priv->paused)
+		return NULL;
+
 	/* check for running exclusive transaction */
 	exclusive_running = pk_scheduler_get_exclusive_running (scheduler) > 0;
 
@@ -512,6 +517,12 @@ pk_scheduler_commit (PkScheduler *scheduler, const gchar *tid)
 		pk_scheduler_cancel_background (scheduler);
 	}
 
+	/* the engine is using the backend, wait until it has finished */
+	if (scheduler->priv->paused) {
+		g_debug ("not running %s as the scheduler is paused", item->tid);
+		return;
+	}
+
 	/* do the transaction now, if possible */
 	if (pk_transaction_is_exclusive (item->transaction) == FALSE ||
 	    pk_scheduler_get_exclusive_running (scheduler) == 0)
@@ -1041,8 +1052,8 @@ pk_scheduler_is_consistent (PkScheduler *scheduler)
 		ret = FALSE;
 	}
 
-	/* nothing running */
-	if (waiting == length) {
+	/* nothing running, and not because the engine is using the backend */
+	if (waiting == length && !scheduler->priv->paused) {
 		pk_scheduler_print (scheduler);
 		ret = FALSE;
 	}
@@ -1061,6 +1072,33 @@ pk_scheduler_wedge_check (PkScheduler *scheduler)
 	return TRUE;
 }
 
+/**
+ * pk_scheduler_set_paused:
+ *
+ * Stops any new transactions from being run while the engine uses the
+ * backend for its own job. Queued transactions are run when unpaused.
+ **/
+void
+pk_scheduler_set_paused (PkScheduler *scheduler, gboolean paused)
+{
+	PkSchedulerItem *item;
+
+	g_return_if_fail (PK_IS_SCHEDULER (scheduler));
+
+	if (scheduler->priv->paused == paused)
+		return;
+	scheduler->priv->paused = paused;
+	if (paused)
+		return;
+
+	/* run anything that was committed while we were paused */
+	while ((item = pk_scheduler_get_next_item (scheduler)) != NULL) {
+		g_debug ("running %s as scheduler was unpaused", item->tid);
+		pk_scheduler_run_item (scheduler, item);
+	}
+	g_signal_emit (scheduler, signals [PK_SCHEDULER_CHANGED], 0);
+}
+
 /**
  * pk_scheduler_set_backend:
  *
@@ -77,6 +77,8 @@ PkTransaction	*pk_scheduler_get_transaction	(PkScheduler	*scheduler,
 						 const gchar	*tid);
 void		 pk_scheduler_cancel_background	(PkScheduler	*scheduler);
 void		 pk_scheduler_cancel_queued	(PkScheduler	*scheduler);
+void		 pk_scheduler_set_paused	(PkScheduler	*scheduler,
+						 gboolean	 paused);
 void		 pk_scheduler_set_backend	(PkScheduler	*scheduler,
 						 PkBackend	*backend);
 
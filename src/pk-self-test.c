@@ -331,6 +331,8 @@ pk_test_backend_spawn_func (void)
 	const gchar *text;
 	gboolean ret;
 	gchar *uri;
+	gchar record_package[] = "package\0installed\0gnome-power-manager;0.0.1;i386;data\0More useless software";
+	gchar record_restart[] = "requirerestart\0system\0details about the restart";
 	GError *error = NULL;
 	g_autoptr(GKeyFile) conf = NULL;
 	g_autoptr(PkBackend) backend = NULL;
@@ -436,6 +438,21 @@ pk_test_backend_spawn_func (void)
 		"package\tinstalled\tgnome-power-manager;0.0.1;i386;data\tMore useless software", NULL);
 	g_assert (ret);
 
+	/* test pk_backend_spawn_inject_record Package */
+	ret = pk_backend_spawn_inject_record (backend_spawn, job,
+					      record_package, sizeof (record_package), NULL);
+	g_assert (ret);
+
+	/* test pk_backend_spawn_inject_record unterminated */
+	ret = pk_backend_spawn_inject_record (backend_spawn, job,
+					      record_package, 7, NULL);
+	g_assert (!ret);
+
+	/* test pk_backend_spawn_inject_record invalid PackageId */
+	ret = pk_backend_spawn_inject_record (backend_spawn, job,
+					      record_restart, sizeof (record_restart), NULL);
+	g_assert (!ret);
+
 	/* manually unlock as we have no engine */
 	ret = pk_backend_unload (backend);
 	g_assert (ret);
@@ -519,6 +536,16 @@ pk_test_stdout_cb (PkSpawn *spawn, const gchar *line, gpointer user_data)
 	stdout_count++;
 }
 
+/**
+ * pk_test_framing_cb:
+ **/
+static void
+pk_test_framing_cb (PkSpawn *spawn, const gchar *line, gpointer user_data)
+{
+	if (g_strcmp0 (line, "framing\tbinary") == 0)
+		pk_spawn_set_framing (spawn, PK_SPAWN_FRAMING_BINARY);
+}
+
 static gboolean
 cancel_cb (gpointer data)
 {
@@ -677,6 +704,24 @@ pk_test_spawn_func (void)
 	/* get new object */
 	new_spawn_object (&spawn);
 
+	/* make sure a stray text line after binary framing kills the helper */
+	mexit = PK_SPAWN_EXIT_TYPE_UNKNOWN;
+	g_signal_connect (spawn, "stdout",
+			  G_CALLBACK (pk_test_framing_cb), NULL);
+	argv = g_strsplit (TESTDATADIR "/pk-spawn-test-framing.sh", " ", 0);
+	ret = pk_spawn_argv (spawn, argv, NULL, PK_SPAWN_ARGV_FLAGS_NONE, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_strfreev (argv);
+
+	/* wait for finished, well before the helper would exit itself */
+	_g_test_loop_run_with_timeout (5000);
+	g_assert_cmpint (mexit, ==, PK_SPAWN_EXIT_TYPE_SIGQUIT);
+	g_assert_cmpint (stdout_count, ==, 1);
+
+	/* get new object */
+	new_spawn_object (&spawn);
+
 	/* run the dispatcher */
 	mexit = PK_SPAWN_EXIT_TYPE_UNKNOWN;
 	argv = g_strsplit (TESTDATADIR "/pk-spawn-dispatcher.py\tsearch-name\tnone\tpower manager", "\t", 0);
@@ -48,6 +48,7 @@ static void     pk_spawn_finalize	(GObject       *object);
 #define PK_SPAWN_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_SPAWN, PkSpawnPrivate))
 #define PK_SPAWN_POLL_DELAY	50 /* ms */
 #define PK_SPAWN_SIGKILL_DELAY	2500 /* ms */
+#define PK_SPAWN_RECORD_MAX	(64 * 1024 * 1024) /* bytes */
 
 struct PkSpawnPrivate
 {
@@ -63,6 +64,8 @@ struct PkSpawnPrivate
 	gboolean		 is_changing_dispatcher;
 	gboolean		 allow_sigkill;
 	PkSpawnExitType		 exit;
+	PkSpawnFraming		 framing;
+	gboolean		 is_desynced;
 	GString			*stdout_buf;
 	GString			*stderr_buf;
 	gchar			*last_argv0;
@@ -73,6 +76,7 @@ struct PkSpawnPrivate
 enum {
 	SIGNAL_EXIT,
 	SIGNAL_STDOUT,
+	SIGNAL_STDOUT_RECORD,
 	SIGNAL_STDERR,
 	SIGNAL_LAST
 };
@@ -97,51 +101,113 @@ pk_spawn_read_fd_into_buffer (gint fd, GString *string)
 	gint bytes_read;
 	gchar buffer[BUFSIZ];
 
-	/* ITS4: ignore, we manually NULL terminate and GString cannot overflow */
-	while ((bytes_read = read (fd, buffer, BUFSIZ-1)) > 0) {
-		buffer[bytes_read] = '\0';
-		g_string_append (string, buffer);
-	}
+	/* binary records may contain NUL bytes, so always append by length */
+	while ((bytes_read = read (fd, buffer, BUFSIZ)) > 0)
+		g_string_append_len (string, buffer, bytes_read);
 
 	return TRUE;
 }
 
+/**
+ * pk_spawn_desynced:
+ *
+ * Once a record length is wrong nothing after it can be trusted, so throw
+ * away the output and kill the dispatcher. The next job spawns a new one.
+ **/
+static void
+pk_spawn_desynced (PkSpawn *spawn, const gchar *reason)
+{
+	g_warning ("lost binary framing (%s), killing dispatcher", reason);
+	spawn->priv->framing = PK_SPAWN_FRAMING_TEXT;
+	spawn->priv->is_desynced = TRUE;
+	if (spawn->priv->kill_id == 0 && !spawn->priv->finished &&
+	    spawn->priv->child_pid != -1)
+		pk_spawn_kill (spawn);
+}
+
 /**
  * pk_spawn_emit_whole_lines:
+ *
+ * Emits all complete lines and binary records in the buffer, switching
+ * between the two whenever the framing is changed by a signal handler.
  **/
 static gboolean
 pk_spawn_emit_whole_lines (PkSpawn *spawn, GString *string)
 {
-	guint i;
-	guint size;
-	guint bytes_processed;
-	g_auto(GStrv) lines = NULL;
+	gchar *nl;
+	gsize line_start;
+	gsize offset = 0;
+	guint32 record_len;
 
 	/* if nothing then don't emit */
-	if (pk_strzero (string->str))
+	if (string->len == 0)
 		return FALSE;
 
-	/* split into lines - the last line may be incomplete */
-	lines = g_strsplit (string->str, "\n", 0);
-	if (lines == NULL)
+	/* the dispatcher is being killed, ignore anything it still says */
+	if (spawn->priv->is_desynced) {
+		g_string_set_size (string, 0);
 		return FALSE;
+	}
 
-	/* find size */
-	size = g_strv_length (lines);
+	while (offset < string->len) {
+		if (spawn->priv->framing == PK_SPAWN_FRAMING_BINARY) {
+			/* little endian 32 bit length, then the payload */
+			if (string->len - offset < sizeof (guint32))
+				break;
+			memcpy (&record_len, string->str + offset, sizeof (guint32));
+			record_len = GUINT32_FROM_LE (record_len);
+			if (record_len == 0 || record_len > PK_SPAWN_RECORD_MAX) {
+				pk_spawn_desynced (spawn, "invalid record length");
+				offset = string->len;
+				break;
+			}
+			if (string->len - offset - sizeof (guint32) < record_len)
+				break;
+			line_start = offset + sizeof (guint32);
+
+			/* every field is NUL terminated, including the last */
+			if (string->str[line_start + record_len - 1] != '\0') {
+				pk_spawn_desynced (spawn, "unterminated record");
+				offset = string->len;
+				break;
+			}
+			offset = line_start + record_len;
+			g_signal_emit (spawn, signals [SIGNAL_STDOUT_RECORD], 0,
+				       string->str + line_start, record_len);
+			continue;
+		}
 
-	bytes_processed = 0;
-	/* we only emit n-1 strings */
-	for (i = 0; i < (size-1); i++) {
-		g_signal_emit (spawn, signals [SIGNAL_STDOUT], 0, lines[i]);
-		/* ITS4: ignore, g_strsplit always NULL terminates */
-		bytes_processed += strlen (lines[i]) + 1;
+		/* the last line may be incomplete */
+		nl = memchr (string->str + offset, '\n', string->len - offset);
+		if (nl == NULL)
+			break;
+		*nl = '\0';
+		line_start = offset;
+		offset = nl - string->str + 1;
+		g_signal_emit (spawn, signals [SIGNAL_STDOUT], 0, string->str + line_start);
 	}
 
-	/* remove the text we've processed */
-	g_string_erase (string, 0, bytes_processed);
+	/* remove the data we've processed */
+	g_string_erase (string, 0, offset);
 	return TRUE;
 }
 
+/**
+ * pk_spawn_set_framing:
+ *
+ * Sets how the rest of the helper standard output is split up. This is
+ * normally called from the ::stdout handler once the helper has
+ * acknowledged the framing, and takes effect from the next byte.
+ **/
+void
+pk_spawn_set_framing (PkSpawn *spawn, PkSpawnFraming framing)
+{
+	g_return_if_fail (PK_IS_SPAWN (spawn));
+	g_debug ("setting framing to %s",
+		 framing == PK_SPAWN_FRAMING_BINARY ? "binary" : "text");
+	spawn->priv->framing = framing;
+}
+
 /**
  * pk_spawn_exit_type_enum_to_string:
  **/
@@ -586,6 +652,9 @@ pk_spawn_argv (PkSpawn *spawn, gchar **argv, gchar **envp,
 
 	/* create spawned object for tracking */
 	spawn->priv->finished = FALSE;
+	spawn->priv->framing = PK_SPAWN_FRAMING_TEXT;
+	spawn->priv->is_desynced = FALSE;
+	g_string_set_size (spawn->priv->stdout_buf, 0);
 	g_debug ("creating new instance of %s", argv[0]);
 	ret = g_spawn_async_with_pipes (NULL, argv, envp,
 				 G_SPAWN_DO_NOT_REAP_CHILD | G_SPAWN_SEARCH_PATH,
@@ -740,6 +809,11 @@ pk_spawn_class_init (PkSpawnClass *klass)
 			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
 			      0, NULL, NULL, g_cclosure_marshal_VOID__STRING,
 			      G_TYPE_NONE, 1, G_TYPE_STRING);
+	signals [SIGNAL_STDOUT_RECORD] =
+		g_signal_new ("stdout-record",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, g_cclosure_marshal_generic,
+			      G_TYPE_NONE, 2, G_TYPE_POINTER, G_TYPE_UINT);
 	signals [SIGNAL_STDERR] =
 		g_signal_new ("stderr",
 			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
@@ -772,6 +846,8 @@ pk_spawn_init (PkSpawn *spawn)
 	spawn->priv->last_envp = NULL;
 	spawn->priv->background = FALSE;
 	spawn->priv->exit = PK_SPAWN_EXIT_TYPE_UNKNOWN;
+	spawn->priv->framing = PK_SPAWN_FRAMING_TEXT;
+	spawn->priv->is_desynced = FALSE;
 
 	spawn->priv->stdout_buf = g_string_new ("");
 	spawn->priv->stderr_buf = g_string_new ("");
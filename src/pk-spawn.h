@@ -73,6 +73,17 @@ typedef enum {
 	PK_SPAWN_ARGV_FLAGS_LAST
 } PkSpawnArgvFlags;
 
+/**
+ * PkSpawnFraming:
+ *
+ * How the standard output of the spawned file is split up
+ **/
+typedef enum {
+	PK_SPAWN_FRAMING_TEXT,			/* newline terminated lines */
+	PK_SPAWN_FRAMING_BINARY,		/* length prefixed records */
+	PK_SPAWN_FRAMING_LAST
+} PkSpawnFraming;
+
 GType		 pk_spawn_get_type			(void);
 PkSpawn		*pk_spawn_new				(GKeyFile		*conf);
 
@@ -85,6 +96,8 @@ gboolean	 pk_spawn_argv				(PkSpawn	*spawn,
 gboolean	 pk_spawn_is_running			(PkSpawn	*spawn);
 gboolean	 pk_spawn_kill				(PkSpawn	*spawn);
 gboolean	 pk_spawn_exit				(PkSpawn	*spawn);
+void		 pk_spawn_set_framing			(PkSpawn	*spawn,
+							 PkSpawnFraming	 framing);
 
 G_END_DECLS
 
@@ -19,6 +19,11 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+/* for memfd_create() and the file sealing fcntls */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "config.h"
 
 #include <stdlib.h>
@@ -36,10 +41,14 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <syslog.h>
+#ifdef HAVE_MEMFD_CREATE
+#include <sys/mman.h>
+#endif
 
 #include <glib/gstdio.h>
 #include <glib/gi18n.h>
 #include <gio/gio.h>
+#include <gio/gunixfdlist.h>
 #include <packagekit-glib2/pk-common.h>
 #include <packagekit-glib2/pk-common-private.h>
 #include <packagekit-glib2/pk-enum.h>
@@ -138,6 +147,9 @@ struct PkTransactionPrivate
 	guint			 registration_id;
 	GDBusConnection		*connection;
 	GDBusNodeInfo		*introspection;
+
+	/* send the results of queries in the BulkResults signal */
+	gboolean		 bulk_results;
 };
 
 typedef enum {
@@ -415,6 +427,217 @@ pk_transaction_status_changed_emit (PkTransaction *transaction, PkStatusEnum sta
 					      g_variant_new_uint32 (status));
 }
 
+/**
+ * pk_transaction_bulk_results_enabled:
+ *
+ * Only the results of queries are kept back, as the packages of the other
+ * roles are needed for the progress as they arrive.
+ **/
+static gboolean
+pk_transaction_bulk_results_enabled (PkTransaction *transaction)
+{
+	if (!transaction->priv->bulk_results)
+		return FALSE;
+
+	switch (transaction->priv->role) {
+	case PK_ROLE_ENUM_DEPENDS_ON:
+	case PK_ROLE_ENUM_GET_FILES:
+	case PK_ROLE_ENUM_GET_PACKAGES:
+	case PK_ROLE_ENUM_GET_UPDATES:
+	case PK_ROLE_ENUM_REQUIRED_BY:
+	case PK_ROLE_ENUM_RESOLVE:
+	case PK_ROLE_ENUM_SEARCH_DETAILS:
+	case PK_ROLE_ENUM_SEARCH_FILE:
+	case PK_ROLE_ENUM_SEARCH_GROUP:
+	case PK_ROLE_ENUM_SEARCH_NAME:
+	case PK_ROLE_ENUM_WHAT_PROVIDES:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+/**
+ * pk_transaction_bulk_results_write:
+ *
+ * Return value: a sealed memfd holding the serialized @results, or -1
+ **/
+static gint
+pk_transaction_bulk_results_write (GVariant *results)
+{
+#ifdef HAVE_MEMFD_CREATE
+	gint fd;
+	gpointer data;
+	gsize size = g_variant_get_size (results);
+
+	fd = memfd_create ("packagekit-results", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd < 0) {
+		g_warning ("failed to create memfd: %s", g_strerror (errno));
+		return -1;
+	}
+	if (size > 0) {
+		if (ftruncate (fd, size) < 0) {
+			g_warning ("failed to size memfd: %s", g_strerror (errno));
+			close (fd);
+			return -1;
+		}
+
+		/* serialize straight into the file rather than into a copy */
+		data = mmap (NULL, size, PROT_WRITE, MAP_SHARED, fd, 0);
+		if (data == MAP_FAILED) {
+			g_warning ("failed to map memfd: %s", g_strerror (errno));
+			close (fd);
+			return -1;
+		}
+		g_variant_store (results, data);
+		munmap (data, size);
+	}
+
+	/* the client maps the file, so it must never change under it */
+	if (fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW |
+				    F_SEAL_WRITE | F_SEAL_SEAL) < 0) {
+		g_warning ("failed to seal memfd: %s", g_strerror (errno));
+		close (fd);
+		return -1;
+	}
+	return fd;
+#else
+	return -1;
+#endif
+}
+
+/**
+ * pk_transaction_bulk_results_new:
+ *
+ * Builds the BulkResults payload from the results the transaction keeps
+ * anyway, so that nothing else has to be held while the backend runs.
+ **/
+static GVariant *
+pk_transaction_bulk_results_new (PkTransaction *transaction)
+{
+	const gchar *package_id;
+	const gchar *summary;
+	guint i;
+	GVariantBuilder packages;
+	GVariantBuilder files;
+	PkInfoEnum info;
+	PkResultsPackageIter iter;
+	g_autoptr(GPtrArray) files_array = NULL;
+
+	g_variant_builder_init (&packages, G_VARIANT_TYPE ("a(uss)"));
+	pk_results_package_iter_init (&iter, transaction->priv->results);
+	while (pk_results_package_iter_next (&iter, &info, &package_id, &summary)) {
+		g_variant_builder_add (&packages, "(uss)",
+				       info,
+				       package_id,
+				       summary != NULL ? summary : "");
+	}
+
+	g_variant_builder_init (&files, G_VARIANT_TYPE ("a(sas)"));
+	files_array = pk_results_get_files_array (transaction->priv->results);
+	for (i = 0; i < files_array->len; i++) {
+		PkFiles *item = g_ptr_array_index (files_array, i);
+		const gchar *files_package_id = pk_files_get_package_id (item);
+		g_variant_builder_add (&files, "(s^as)",
+				       files_package_id != NULL ? files_package_id : "",
+				       pk_files_get_files (item));
+	}
+
+	return g_variant_ref_sink (g_variant_new ("(u@a(uss)@a(sas))",
+						  PK_BULK_RESULTS_VERSION,
+						  g_variant_builder_end (&packages),
+						  g_variant_builder_end (&files)));
+}
+
+/**
+ * pk_transaction_bulk_results_emit:
+ *
+ * Sends the kept back results as one memfd, or as the individual signals
+ * if that is not possible.
+ *
+ * The signal is broadcast like the Package and Files signals it replaces,
+ * so that clients which adopted the transaction get the results too. The
+ * bus only hands the fd to connections that can receive fds.
+ **/
+static void
+pk_transaction_bulk_results_emit (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+	gint fd = -1;
+	gsize size = 0;
+	guint i;
+	g_autoptr(GDBusMessage) message = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GUnixFDList) fd_list = NULL;
+
+	if (!pk_transaction_bulk_results_enabled (transaction))
+		return;
+	if (pk_results_get_package_count (priv->results) == 0) {
+		g_autoptr(GPtrArray) files_array = pk_results_get_files_array (priv->results);
+		if (files_array->len == 0)
+			return;
+	}
+
+	if ((g_dbus_connection_get_capabilities (priv->connection) &
+	     G_DBUS_CAPABILITY_FLAGS_UNIX_FD_PASSING) > 0) {
+		g_autoptr(GVariant) results = pk_transaction_bulk_results_new (transaction);
+		size = g_variant_get_size (results);
+		fd = pk_transaction_bulk_results_write (results);
+	}
+
+	/* fall back to the signals the clients would have got anyway */
+	if (fd < 0) {
+		const gchar *package_id;
+		const gchar *summary;
+		PkInfoEnum info;
+		PkResultsPackageIter iter;
+		g_autoptr(GPtrArray) files_array = NULL;
+
+		pk_results_package_iter_init (&iter, priv->results);
+		while (pk_results_package_iter_next (&iter, &info, &package_id, &summary)) {
+			g_dbus_connection_emit_signal (priv->connection,
+						       NULL,
+						       priv->tid,
+						       PK_DBUS_INTERFACE_TRANSACTION,
+						       "Package",
+						       g_variant_new ("(uss)",
+								      info,
+								      package_id,
+								      summary != NULL ? summary : ""),
+						       NULL);
+		}
+		files_array = pk_results_get_files_array (priv->results);
+		for (i = 0; i < files_array->len; i++) {
+			PkFiles *item = g_ptr_array_index (files_array, i);
+			package_id = pk_files_get_package_id (item);
+			g_dbus_connection_emit_signal (priv->connection,
+						       NULL,
+						       priv->tid,
+						       PK_DBUS_INTERFACE_TRANSACTION,
+						       "Files",
+						       g_variant_new ("(s^as)",
+								      package_id != NULL ? package_id : "",
+								      pk_files_get_files (item)),
+						       NULL);
+		}
+		return;
+	}
+
+	fd_list = g_unix_fd_list_new_from_array (&fd, 1);
+	message = g_dbus_message_new_signal (priv->tid,
+					     PK_DBUS_INTERFACE_TRANSACTION,
+					     "BulkResults");
+	g_dbus_message_set_body (message, g_variant_new ("(h)", 0));
+	g_dbus_message_set_unix_fd_list (message, fd_list);
+	g_debug ("emitting bulk results of %" G_GSIZE_FORMAT " bytes", size);
+	if (!g_dbus_connection_send_message (priv->connection,
+					     message,
+					     G_DBUS_SEND_MESSAGE_FLAGS_NONE,
+					     NULL,
+					     &error))
+		g_warning ("failed to emit bulk results: %s", error->message);
+}
+
 /**
  * pk_transaction_finished_emit:
  **/
@@ -423,6 +646,9 @@ pk_transaction_finished_emit (PkTransaction *transaction,
 			      PkExitEnum exit_enum,
 			      guint time_ms)
 {
+	/* the results have to arrive before the client sees Finished */
+	pk_transaction_bulk_results_emit (transaction);
+
 	g_debug ("emitting finished '%s', %i",
 		 pk_exit_enum_to_string (exit_enum),
 		 time_ms);
@@ -627,6 +853,10 @@ pk_transaction_files_cb (PkBackendJob *job,
 	/* add to results */
 	pk_results_add_files (transaction->priv->results, item);
 
+	/* kept back for the BulkResults signal */
+	if (pk_transaction_bulk_results_enabled (transaction))
+		return;
+
 	/* emit */
 	g_debug ("emitting files %s", package_id);
 	g_dbus_connection_emit_signal (transaction->priv->connection,
@@ -1296,6 +1526,11 @@ pk_transaction_package_cb (PkBackend *backend,
 			 package_id,
 			 summary);
 	}
+
+	/* kept back for the BulkResults signal */
+	if (info != PK_INFO_ENUM_FINISHED &&
+	    pk_transaction_bulk_results_enabled (transaction))
+		return;
 	g_dbus_connection_emit_signal (transaction->priv->connection,
 				       NULL,
 				       transaction->priv->tid,
@@ -4846,6 +5081,22 @@ pk_transaction_set_hint (PkTransaction *transaction,
 		return TRUE;
 	}
 
+	/* bulk-results=true */
+	if (g_strcmp0 (key, "bulk-results") == 0) {
+		if (g_strcmp0 (value, "true") == 0) {
+			priv->bulk_results = TRUE;
+		} else if (g_strcmp0 (value, "false") == 0) {
+			priv->bulk_results = FALSE;
+		} else {
+			g_set_error (error,
+				     PK_TRANSACTION_ERROR,
+				     PK_TRANSACTION_ERROR_NOT_SUPPORTED,
+				     "bulk-results hint expects true or false, not %s", value);
+			return FALSE;
+		}
+		return TRUE;
+	}
+
 	/* to preserve forwards and backwards compatibility, we ignore
 	 * extra options here */
 	g_warning ("unknown option: %s with value %s", key, value);